@@ -1,19 +1,55 @@
 set(LIBRARY_HEADER_FILES
         ${PROJECT_SOURCE_DIR}/include/tape_sorter/tape_interface.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/tape_operation_counts.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/buffer_arena.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/thread_pool.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/spsc_ring_buffer.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/write_behind_tape.h
         ${PROJECT_SOURCE_DIR}/include/tape_sorter/file_tape.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/file_tape_backend.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/file_tape_format.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/tape_metadata.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/stream_tape.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sparse_index.h
         ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/tape_sorter.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/run_layout.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/merge_tapes.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/tapes_priority_queue.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/sort_stability.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/sort_engine.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/verifying_tape.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/sort_verification.h
         ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/temp_tape_creator_interface.h
         ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/temp_file_tape_creator.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/drive_pool.h
+        ${PROJECT_SOURCE_DIR}/include/tape_sorter/sort/sort_service.h
         ${PROJECT_SOURCE_DIR}/include/tape_sorter/delay_config/tape_delay_config_parser.h
         ${PROJECT_SOURCE_DIR}/include/tape_sorter/delay_config/tape_delay_config.h
 )
 
 set(LIBRARY_SOURCE_FILES
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/buffer_arena.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/thread_pool.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/write_behind_tape.cpp
         ${PROJECT_SOURCE_DIR}/src/tape_sorter/file_tape.cpp
-        ${PROJECT_SOURCE_DIR}/src/tape_sorter/sort/tapes_priority_queue.h
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/stream_tape.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/sparse_index.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/file_tape_storage_interface.h
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/stream_file_storage.h
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/stream_file_storage.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/async_file_io.h
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/async_file_io.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/direct_file_storage.h
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/direct_file_storage.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/tape_file_header.h
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/tape_file_header.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/framed_file_storage.h
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/storage/framed_file_storage.cpp
         ${PROJECT_SOURCE_DIR}/src/tape_sorter/sort/tape_sorter.cpp
         ${PROJECT_SOURCE_DIR}/src/tape_sorter/delay_config/tape_delay_config_parser.cpp
         ${PROJECT_SOURCE_DIR}/src/tape_sorter/sort/temp_file_tape_creator.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/sort/drive_pool.cpp
+        ${PROJECT_SOURCE_DIR}/src/tape_sorter/sort/sort_service.cpp
 )
 
 add_library(${LIBRARY_NAME}
@@ -23,6 +59,9 @@ add_library(${LIBRARY_NAME}
 
 add_library(${PROJECT_NAME}::${LIBRARY_NAME} ALIAS ${LIBRARY_NAME})
 
+find_package(Threads REQUIRED)
+target_link_libraries(${LIBRARY_NAME} PUBLIC Threads::Threads)
+
 target_compile_features(${LIBRARY_NAME} PUBLIC cxx_std_${CMAKE_CXX_STANDARD})
 
 target_include_directories(
@@ -12,14 +12,25 @@
 //   See the License for the specific language governing permissions and
 //   limitations under the License.
 
+#include <unistd.h>
+
 #include <boost/program_options.hpp>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <tape_sorter/sort/drive_pool.h>
 #include <tape_sorter/sort/tape_sorter.h>
 #include <tape_sorter/sort/temp_file_tape_creator.h>
 #include <tape_sorter/delay_config/tape_delay_config_parser.h>
+#include <tape_sorter/stream_tape.h>
 
 namespace po = boost::program_options;
 namespace ts = tape_sorter;
 
+// Path denoting stdin for the input and stdout for the output
+constexpr const auto kStandardStreamPath = "-";
+
 void PrintHelpMessage(const std::string &program_name,
                       const po::options_description &optionals) {
   std::cout << "Usage: " << program_name
@@ -27,23 +38,389 @@ void PrintHelpMessage(const std::string &program_name,
   std::cout << optionals << '\n';
 }
 
+ts::StreamFormat ParseStreamFormat(const po::variables_map &parsed_variables,
+                                   const std::string &option) {
+  auto format = parsed_variables[option].as<std::string>();
+  if (format == "binary") {
+    return ts::StreamFormat::kBinary;
+  }
+  if (format == "text") {
+    return ts::StreamFormat::kText;
+  }
+  throw po::validation_error(po::validation_error::invalid_option_value,
+                             option, format);
+}
+
+ts::FileTapeBackend ParseBackend(const po::variables_map &parsed_variables,
+                                 const std::string &option) {
+  auto backend = parsed_variables[option].as<std::string>();
+  if (backend == "stream") {
+    return ts::FileTapeBackend::kStream;
+  }
+  if (backend == "direct") {
+    return ts::FileTapeBackend::kDirect;
+  }
+  throw po::validation_error(po::validation_error::invalid_option_value,
+                             option, backend);
+}
+
+ts::RunLayout ParseRunLayout(const po::variables_map &parsed_variables,
+                             const std::string &option) {
+  auto layout = parsed_variables[option].as<std::string>();
+  if (layout == "backward") {
+    return ts::RunLayout::kBackward;
+  }
+  if (layout == "forward") {
+    return ts::RunLayout::kForward;
+  }
+  throw po::validation_error(po::validation_error::invalid_option_value,
+                             option, layout);
+}
+
+ts::SortEngine ParseSortEngine(const po::variables_map &parsed_variables,
+                               const std::string &option) {
+  auto engine = parsed_variables[option].as<std::string>();
+  if (engine == "merge") {
+    return ts::SortEngine::kMerge;
+  }
+  if (engine == "distribution") {
+    return ts::SortEngine::kDistribution;
+  }
+  if (engine == "counting") {
+    return ts::SortEngine::kCounting;
+  }
+  throw po::validation_error(po::validation_error::invalid_option_value,
+                             option, engine);
+}
+
+// Bytes with an optional K, M or G suffix
+size_t ParseSize(const po::variables_map &parsed_variables,
+                 const std::string &option) {
+  auto size = parsed_variables[option].as<std::string>();
+  auto invalid_size = [&] {
+    return po::validation_error(po::validation_error::invalid_option_value,
+                                option, size);
+  };
+  // std::stoull takes a sign and wraps a negative value around
+  if (size.empty() || !std::isdigit(static_cast<unsigned char>(size[0]))) {
+    throw invalid_size();
+  }
+  size_t suffix_position = 0;
+  size_t bytes = 0;
+  try {
+    bytes = std::stoull(size, &suffix_position);
+  } catch (const std::logic_error &) {
+    throw invalid_size();
+  }
+  auto suffix = size.substr(suffix_position);
+  size_t shift = 0;
+  if (suffix == "K") {
+    shift = 10;
+  } else if (suffix == "M") {
+    shift = 20;
+  } else if (suffix == "G") {
+    shift = 30;
+  } else if (!suffix.empty()) {
+    throw invalid_size();
+  }
+  if (bytes > std::numeric_limits<size_t>::max() >> shift) {
+    throw invalid_size();
+  }
+  return bytes << shift;
+}
+
+// "<min>:<max>", both included
+ts::KeyRange ParseKeyRange(const po::variables_map &parsed_variables,
+                           const std::string &option) {
+  auto range = parsed_variables[option].as<std::string>();
+  auto separator = range.find(':');
+  if (separator != std::string::npos) {
+    auto max = range.substr(separator + 1);
+    size_t min_end = 0;
+    size_t max_end = 0;
+    try {
+      ts::KeyRange key_range{std::stoi(range, &min_end),
+                             std::stoi(max, &max_end)};
+      if (min_end == separator && max_end == max.size()) {
+        return key_range;
+      }
+    } catch (const std::logic_error &) {
+    }
+  }
+  throw po::validation_error(po::validation_error::invalid_option_value,
+                             option, range);
+}
+
+// Path with an optional ":<weight>" suffix
+ts::TempDirectory ParseTempDirectory(const std::string &directory) {
+  auto separator = directory.rfind(':');
+  if (separator == std::string::npos) {
+    return {directory};
+  }
+  auto weight = directory.substr(separator + 1);
+  size_t weight_end = 0;
+  try {
+    auto value = std::stod(weight, &weight_end);
+    if (weight_end == weight.size()) {
+      return {directory.substr(0, separator), value};
+    }
+  } catch (const std::logic_error &) {
+  }
+  return {directory};
+}
+
+ts::TempPlacement ParseTempPlacement(const po::variables_map &parsed_variables,
+                                     const std::string &option) {
+  auto placement = parsed_variables[option].as<std::string>();
+  if (placement == "round-robin") {
+    return ts::TempPlacement::kRoundRobin;
+  }
+  if (placement == "free-space") {
+    return ts::TempPlacement::kFreeSpace;
+  }
+  throw po::validation_error(po::validation_error::invalid_option_value,
+                             option, placement);
+}
+
+// Binary files are random access tapes, anything else is streamed
+std::unique_ptr<ts::ITape> CreateInputTape(
+    const std::string &path, ts::StreamFormat format,
+    const ts::TapeDelayConfig &delay_config, ts::FileTapeBackend backend) {
+  if (path == kStandardStreamPath) {
+    return std::make_unique<ts::InputStreamTape>(STDIN_FILENO, format);
+  }
+  if (format == ts::StreamFormat::kText) {
+    return std::make_unique<ts::InputStreamTape>(std::filesystem::path{path},
+                                                 format);
+  }
+  return std::make_unique<ts::FileTape>(path, delay_config, backend);
+}
+
+std::unique_ptr<ts::ITape> CreateOutputTape(
+    const std::string &path, ts::StreamFormat format,
+    const ts::TapeDelayConfig &delay_config, ts::FileTapeBackend backend,
+    ts::FileTapeFormat file_format) {
+  if (path == kStandardStreamPath) {
+    return std::make_unique<ts::OutputStreamTape>(STDOUT_FILENO, format);
+  }
+  if (format == ts::StreamFormat::kText) {
+    return std::make_unique<ts::OutputStreamTape>(std::filesystem::path{path},
+                                                  format);
+  }
+  return std::make_unique<ts::FileTape>(
+      path, delay_config, backend, std::make_shared<ts::TapeOperationCounts>(),
+      nullptr, file_format);
+}
+
+// Operation counts of the tape, if it counts them
+const ts::TapeOperationCounts *GetOperationCounts(const ts::ITape &tape) {
+  if (const auto *file_tape = dynamic_cast<const ts::FileTape *>(&tape)) {
+    return &file_tape->GetOperationCounts();
+  }
+  return nullptr;
+}
+
+double ToMilliseconds(std::chrono::nanoseconds duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+struct Report {
+  ts::SortStatistics statistics;
+  std::chrono::nanoseconds total_time;
+  const ts::TapeOperationCounts *input_counts;
+  const ts::TapeOperationCounts *output_counts;
+  const ts::TapeOperationCounts *temp_counts;
+  // Set when temporary tapes are mounted on a few drives
+  const ts::DrivePool *drive_pool;
+};
+
+// Name of the engine as the engine option takes it
+const char *GetSortEngineName(ts::SortEngine engine) {
+  if (engine == ts::SortEngine::kDistribution) {
+    return "distribution";
+  }
+  if (engine == ts::SortEngine::kCounting) {
+    return "counting";
+  }
+  return "merge";
+}
+
+double ToValuesPerSecond(const Report &report) {
+  auto seconds = std::chrono::duration<double>(report.total_time).count();
+  return seconds > 0 ? report.statistics.values_number / seconds : 0;
+}
+
+void PrintTextCounts(std::ostream &stream, const std::string &name,
+                     const ts::TapeOperationCounts *counts) {
+  stream << std::setw(8) << std::left << name << std::right;
+  if (counts == nullptr) {
+    stream << " not counted\n";
+    return;
+  }
+  stream << " reads " << counts->reads << ", writes " << counts->writes
+         << ", moves " << counts->moves << " (" << counts->backward_moves
+         << " backward), rewinds " << counts->rewinds << ", delay "
+         << ToMilliseconds(counts->total_delay) << " ms\n";
+}
+
+void PrintTextReport(std::ostream &stream, const Report &report) {
+  const auto &statistics = report.statistics;
+  auto values_per_second = ToValuesPerSecond(report);
+  stream << std::fixed << std::setprecision(1);
+  stream << "engine   " << GetSortEngineName(statistics.engine) << '\n';
+  stream << "values   " << statistics.values_number << '\n';
+  stream << "runs     " << statistics.runs_number << ", early merges "
+         << statistics.early_merges_number << '\n';
+  stream << "time     run generation "
+         << ToMilliseconds(statistics.run_generation_time) << " ms, merge "
+         << ToMilliseconds(statistics.merge_time) << " ms, total "
+         << ToMilliseconds(report.total_time) << " ms, modeled "
+         << ToMilliseconds(statistics.modeled_time) << " ms\n";
+  if (report.drive_pool != nullptr) {
+    stream << "drives   " << report.drive_pool->GetMaxMountedTapes()
+           << ", mounts " << report.drive_pool->GetMountsNumber() << '\n';
+  }
+  stream << "speed    " << values_per_second << " values/s, "
+         << values_per_second * sizeof(int) / (1 << 20) << " MiB/s\n";
+  PrintTextCounts(stream, "input", report.input_counts);
+  PrintTextCounts(stream, "output", report.output_counts);
+  PrintTextCounts(stream, "temp", report.temp_counts);
+}
+
+void PrintJsonCounts(std::ostream &stream, const std::string &name,
+                     const ts::TapeOperationCounts *counts) {
+  stream << '"' << name << "\":";
+  if (counts == nullptr) {
+    stream << "null";
+    return;
+  }
+  stream << "{\"reads\":" << counts->reads << ",\"writes\":" << counts->writes
+         << ",\"moves\":" << counts->moves
+         << ",\"backward_moves\":" << counts->backward_moves
+         << ",\"rewinds\":" << counts->rewinds
+         << ",\"seeks\":" << counts->seeks
+         << ",\"delay_ms\":" << ToMilliseconds(counts->total_delay) << '}';
+}
+
+void PrintJsonReport(std::ostream &stream, const Report &report) {
+  const auto &statistics = report.statistics;
+  auto values_per_second = ToValuesPerSecond(report);
+  stream << std::fixed << std::setprecision(3);
+  stream << "{\"engine\":\"" << GetSortEngineName(statistics.engine) << '"'
+         << ",\"values\":" << statistics.values_number
+         << ",\"runs\":" << statistics.runs_number
+         << ",\"early_merges\":" << statistics.early_merges_number
+         << ",\"time_ms\":{\"run_generation\":"
+         << ToMilliseconds(statistics.run_generation_time)
+         << ",\"merge\":" << ToMilliseconds(statistics.merge_time)
+         << ",\"total\":" << ToMilliseconds(report.total_time)
+         << ",\"modeled\":" << ToMilliseconds(statistics.modeled_time) << '}'
+         << ",\"throughput\":{\"values_per_second\":" << values_per_second
+         << ",\"mib_per_second\":"
+         << values_per_second * sizeof(int) / (1 << 20) << '}'
+         << ",\"tapes\":{";
+  PrintJsonCounts(stream, "input", report.input_counts);
+  stream << ',';
+  PrintJsonCounts(stream, "output", report.output_counts);
+  stream << ',';
+  PrintJsonCounts(stream, "temp", report.temp_counts);
+  stream << "},\"drives\":";
+  if (report.drive_pool == nullptr) {
+    stream << "null";
+  } else {
+    stream << "{\"number\":" << report.drive_pool->GetMaxMountedTapes()
+           << ",\"mounts\":" << report.drive_pool->GetMountsNumber() << '}';
+  }
+  stream << "}\n";
+}
+
 int main(int argc, char *argv[]) {
   constexpr const auto kHelp = "help";
   constexpr const auto kInputFileTapePath = "input-path";
   constexpr const auto kOutputFileTapePath = "output-path";
   constexpr const auto kDelayConfigPath = "delay-path";
   constexpr const auto kMaxBufferSize = "buffer";
+  constexpr const auto kMemory = "memory";
+  constexpr const auto kThreads = "threads";
+  constexpr const auto kWriteBehind = "write-behind";
+  constexpr const auto kMemoryTail = "memory-tail";
+  constexpr const auto kEngine = "engine";
+  constexpr const auto kKeyRange = "key-range";
+  constexpr const auto kStrictEngine = "strict-engine";
+  constexpr const auto kTempDirectories = "temp-dir";
+  constexpr const auto kTempPlacement = "temp-placement";
+  constexpr const auto kDrives = "drives";
+  constexpr const auto kMountDelay = "mount-delay";
+  constexpr const auto kUnmountDelay = "unmount-delay";
+  constexpr const auto kBackend = "backend";
+  constexpr const auto kLayout = "layout";
+  constexpr const auto kHugePages = "huge-pages";
+  constexpr const auto kFramed = "framed";
+  constexpr const auto kIndexStride = "index-stride";
+  constexpr const auto kInputFormat = "input-format";
+  constexpr const auto kOutputFormat = "output-format";
+  constexpr const auto kVerify = "verify";
+  constexpr const auto kPrint = "print";
+  constexpr const auto kReport = "report";
 
   po::options_description options_description("Allowed options");
   options_description.add_options()(kHelp, "Produce help message")(
       kInputFileTapePath, po::value<std::string>()->required(),
-      "Path to input file tape")(kOutputFileTapePath,
-                                 po::value<std::string>()->required(),
-                                 "Path to output file tape")(
+      "Path to input file tape, '-' for stdin")(
+      kOutputFileTapePath, po::value<std::string>()->required(),
+      "Path to output file tape, '-' for stdout")(
       kDelayConfigPath, po::value<std::string>()->required(),
       "Path to tape delay config")(kMaxBufferSize,
                                    po::value<size_t>()->default_value(50),
-                                   "Max buffer size");
+                                   "Max buffer size, in values")(
+      kMemory, po::value<std::string>(),
+      "Memory budget in bytes with an optional K, M or G suffix, replaces "
+      "--buffer")(kThreads, po::value<size_t>()->default_value(1),
+                  "Threads sorting each block in memory")(
+      kWriteBehind, po::value<size_t>()->default_value(0),
+      "Values buffered for a thread writing the output tape, 0 writes it on "
+      "the merging thread")(
+      kMemoryTail, po::bool_switch(),
+      "Merge the last run from memory instead of a temporary tape")(
+      kEngine, po::value<std::string>()->default_value("merge"),
+      "Sort engine: merge of runs, distribution into buckets or counting "
+      "of keys")(kKeyRange, po::value<std::string>(),
+                 "Values of the input for the counting engine, <min>:<max>, "
+                 "taken from the metadata of a framed input by default")(
+      kStrictEngine, po::bool_switch(),
+      "Fail instead of merging an input the counting engine does not fit")(
+      kTempDirectories, po::value<std::vector<std::string>>()->composing(),
+      "Directory of temporary tapes with an optional :<weight> suffix, may "
+      "be repeated")(kTempPlacement,
+                     po::value<std::string>()->default_value("round-robin"),
+                     "Placement of temporary tapes in the directories: "
+                     "round-robin or free-space")(
+      kDrives, po::value<size_t>(),
+      "Drives temporary tapes are mounted on, at least 3")(
+      kMountDelay, po::value<size_t>()->default_value(0),
+      "Modeled mount delay with --drives, in ms")(
+      kUnmountDelay, po::value<size_t>()->default_value(0),
+      "Modeled unmount delay with --drives, in ms")(
+      kBackend, po::value<std::string>()->default_value("stream"),
+      "Backend of binary file tapes: stream or direct")(
+      kLayout, po::value<std::string>()->default_value("backward"),
+      "Layout of temporary tapes: backward or forward")(
+      kHugePages, po::bool_switch(), "Back buffers with huge pages")(
+      kInputFormat, po::value<std::string>()->default_value("binary"),
+      "Input format: binary or text")(
+      kOutputFormat, po::value<std::string>()->default_value("binary"),
+      "Output format: binary or text")(
+      kFramed, po::bool_switch(),
+      "Write a new binary output with a header and block checksums")(
+      kIndexStride, po::value<size_t>()->default_value(0),
+      "Write every N-th output value and its position to "
+      "<OUTPUT_PATH>.idx, 0 writes no index")(
+      kVerify, po::bool_switch(),
+      "Check that the output is a sorted permutation of the input")(
+      kPrint, po::bool_switch(),
+      "Print the sorted values to stdout after sorting")(
+      kReport, po::value<std::string>()->default_value("text"),
+      "Performance report printed to stderr: text, json or none");
   po::positional_options_description positionals;
   positionals.add(kInputFileTapePath, 1);
   positionals.add(kOutputFileTapePath, 1);
@@ -60,26 +437,119 @@ int main(int argc, char *argv[]) {
       PrintHelpMessage(argv[0], options_description);
     } else {
       po::notify(parsed_variables);
-      auto input_tape_path = std::filesystem::path{
-          parsed_variables[kInputFileTapePath].as<std::string>()};
-      auto output_tape_path = std::filesystem::path{
-          parsed_variables[kOutputFileTapePath].as<std::string>()};
+      auto input_tape_path =
+          parsed_variables[kInputFileTapePath].as<std::string>();
+      auto output_tape_path =
+          parsed_variables[kOutputFileTapePath].as<std::string>();
+      auto input_format = ParseStreamFormat(parsed_variables, kInputFormat);
+      auto output_format = ParseStreamFormat(parsed_variables, kOutputFormat);
+      auto backend = ParseBackend(parsed_variables, kBackend);
+      auto report_format = parsed_variables[kReport].as<std::string>();
+      if (report_format != "text" && report_format != "json" &&
+          report_format != "none") {
+        throw po::validation_error(po::validation_error::invalid_option_value,
+                                   kReport, report_format);
+      }
       auto delay_config_path = std::filesystem::path{
           parsed_variables[kDelayConfigPath].as<std::string>()};
 
       auto delay_config = ts::TapeDelayConfigParser::Parse(delay_config_path);
-      auto input_tape = ts::FileTape{input_tape_path, delay_config};
-      auto output_tape = ts::FileTape{output_tape_path, delay_config};
-
-      auto buffer_size = parsed_variables[kMaxBufferSize].as<size_t>();
-      auto temp_tape_creator =
-          std::make_unique<ts::TempFileTapeCreator>(delay_config);
-      auto sorter = ts::TapeSorter{buffer_size, std::move(temp_tape_creator)};
-      sorter.Sort(input_tape, output_tape);
-      output_tape.Rewind();
-      while (output_tape.Read()) {
-        std::cout << output_tape.Read().value() << ' ';
-        output_tape.MoveForward();
+      auto input_tape = CreateInputTape(input_tape_path, input_format,
+                                        delay_config, backend);
+      auto output_tape = CreateOutputTape(
+          output_tape_path, output_format, delay_config, backend,
+          parsed_variables[kFramed].as<bool>() ? ts::FileTapeFormat::kFramed
+                                               : ts::FileTapeFormat::kRaw);
+
+      std::vector<ts::TempDirectory> temp_directories;
+      if (parsed_variables.count(kTempDirectories) != 0u) {
+        for (const auto &directory :
+             parsed_variables[kTempDirectories]
+                 .as<std::vector<std::string>>()) {
+          temp_directories.push_back(ParseTempDirectory(directory));
+        }
+      }
+      auto temp_file_tape_creator = std::make_unique<ts::TempFileTapeCreator>(
+          delay_config, backend, std::move(temp_directories),
+          ParseTempPlacement(parsed_variables, kTempPlacement));
+      const auto &temp_tapes = *temp_file_tape_creator;
+      std::unique_ptr<ts::ITempTapeCreator> temp_tape_creator =
+          std::move(temp_file_tape_creator);
+      const ts::DrivePool *drive_pool = nullptr;
+      if (parsed_variables.count(kDrives) != 0u) {
+        auto pool = std::make_unique<ts::DrivePool>(
+            std::move(temp_tape_creator),
+            ts::DrivePoolConfig{
+                parsed_variables[kDrives].as<size_t>(),
+                std::chrono::milliseconds{
+                    parsed_variables[kMountDelay].as<size_t>()},
+                std::chrono::milliseconds{
+                    parsed_variables[kUnmountDelay].as<size_t>()}});
+        drive_pool = pool.get();
+        temp_tape_creator = std::move(pool);
+      }
+
+      ts::SortOptions options;
+      options.run_layout = ParseRunLayout(parsed_variables, kLayout);
+      options.verify = parsed_variables[kVerify].as<bool>();
+      options.threads_number = parsed_variables[kThreads].as<size_t>();
+      options.write_behind_buffer_size =
+          parsed_variables[kWriteBehind].as<size_t>();
+      options.keep_tail_run_in_memory =
+          parsed_variables[kMemoryTail].as<bool>();
+      options.engine = ParseSortEngine(parsed_variables, kEngine);
+      if (parsed_variables.count(kKeyRange) != 0u) {
+        options.key_range = ParseKeyRange(parsed_variables, kKeyRange);
+      }
+      options.strict_engine = parsed_variables[kStrictEngine].as<bool>();
+      if (auto index_stride = parsed_variables[kIndexStride].as<size_t>()) {
+        if (output_tape_path == kStandardStreamPath) {
+          throw std::invalid_argument(
+              "The index needs an output file, not the standard output\n");
+        }
+        options.sparse_index = std::make_shared<ts::SparseIndex>(index_stride);
+      }
+      options.buffer_arena = std::make_shared<ts::BufferArena>(
+          parsed_variables[kHugePages].as<bool>());
+      auto sorter =
+          parsed_variables.count(kMemory) != 0u
+              ? ts::TapeSorter{ts::MemoryBudget{ParseSize(parsed_variables,
+                                                          kMemory)},
+                               std::move(temp_tape_creator), options}
+              : ts::TapeSorter{parsed_variables[kMaxBufferSize].as<size_t>(),
+                               std::move(temp_tape_creator), options};
+
+      auto start = std::chrono::steady_clock::now();
+      auto statistics = sorter.Sort(*input_tape, *output_tape);
+      if (auto *output_stream_tape =
+              dynamic_cast<ts::OutputStreamTape *>(output_tape.get())) {
+        output_stream_tape->Flush();
+      } else if (auto *output_file_tape =
+                     dynamic_cast<ts::FileTape *>(output_tape.get())) {
+        output_file_tape->Flush();
+      }
+      if (options.sparse_index) {
+        options.sparse_index->Save(
+            ts::SparseIndex::GetSidecarPath(output_tape_path));
+      }
+      Report report{statistics, std::chrono::steady_clock::now() - start,
+                    GetOperationCounts(*input_tape),
+                    GetOperationCounts(*output_tape),
+                    &temp_tapes.GetOperationCounts(), drive_pool};
+
+      if (parsed_variables[kPrint].as<bool>() &&
+          output_tape_path != kStandardStreamPath &&
+          output_format == ts::StreamFormat::kBinary) {
+        output_tape->Rewind();
+        while (auto value = output_tape->ReadForward()) {
+          std::cout << value.value() << ' ';
+        }
+        std::cout << '\n';
+      }
+      if (report_format == "text") {
+        PrintTextReport(std::cerr, report);
+      } else if (report_format == "json") {
+        PrintJsonReport(std::cerr, report);
       }
     }
   } catch (po::error &e) {
@@ -89,6 +559,12 @@ int main(int argc, char *argv[]) {
   } catch (const std::runtime_error &error) {
     std::cerr << "ERROR: " << error.what() << "\n";
     return 1;
+  } catch (const std::invalid_argument &error) {
+    std::cerr << "ERROR: " << error.what() << "\n";
+    return 1;
+  } catch (const std::out_of_range &error) {
+    std::cerr << "ERROR: " << error.what() << "\n";
+    return 1;
   }
 
   return 0;
@@ -0,0 +1,147 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <boost/program_options.hpp>
+#include <tape_sorter/sort/tape_sorter.h>
+#include <tape_sorter/sort/temp_file_tape_creator.h>
+#include <tape_sorter/delay_config/tape_delay_config_parser.h>
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <system_error>
+
+namespace po = boost::program_options;
+namespace ts = tape_sorter;
+
+void PrintHelpMessage(const std::string &program_name,
+                      const po::options_description &optionals) {
+  std::cout << "Usage: " << program_name << " <DELAY_CONFIG_PATH> [options]\n";
+  std::cout << optionals << '\n';
+}
+
+void WriteRandomNumbers(const std::filesystem::path &path, size_t size) {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<> distribution;
+  std::ofstream file(path, std::ofstream::binary);
+  for (auto i = 0ul; i != size; ++i) {
+    auto value = distribution(generator);
+    file.write(reinterpret_cast<char *>(&value), sizeof(value));
+  }
+}
+
+// Created empty with a unique name, so concurrent runs do not share it
+std::filesystem::path CreateTemporaryFile() {
+  auto path = (std::filesystem::temp_directory_path() /
+               "layout_benchmark.XXXXXX")
+                  .string();
+  auto descriptor = ::mkstemp(path.data());
+  if (descriptor == -1) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Cannot create a temporary file");
+  }
+  ::close(descriptor);
+  return path;
+}
+
+void RunBenchmark(const std::string &name, ts::RunLayout run_layout,
+                  const ts::TapeDelayConfig &delay_config, size_t size,
+                  size_t buffer_size) {
+  auto input_tape_path = CreateTemporaryFile();
+  auto output_tape_path = CreateTemporaryFile();
+  WriteRandomNumbers(input_tape_path, size);
+  {
+    auto input_tape = ts::FileTape{input_tape_path, delay_config};
+    auto output_tape = ts::FileTape{output_tape_path, delay_config};
+    auto temp_tape_creator =
+        std::make_unique<ts::TempFileTapeCreator>(delay_config);
+    const auto &temp_tapes = *temp_tape_creator;
+    ts::SortOptions options;
+    options.run_layout = run_layout;
+    auto sorter =
+        ts::TapeSorter{buffer_size, std::move(temp_tape_creator), options};
+
+    auto start = std::chrono::steady_clock::now();
+    sorter.Sort(input_tape, output_tape);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    auto counts = input_tape.GetOperationCounts();
+    counts += output_tape.GetOperationCounts();
+    counts += temp_tapes.GetOperationCounts();
+    std::cout << name << ": " << elapsed.count() << " ms elapsed, "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     counts.total_delay)
+                     .count()
+              << " ms of tape delays ("
+              << counts.reads << " reads, " << counts.writes << " writes, "
+              << counts.moves << " moves of which " << counts.backward_moves
+              << " backward, " << counts.rewinds << " rewinds)\n";
+  }
+  std::filesystem::remove(input_tape_path);
+  std::filesystem::remove(output_tape_path);
+}
+
+int main(int argc, char *argv[]) {
+  constexpr const auto kHelp = "help";
+  constexpr const auto kDelayConfigPath = "delay-path";
+  constexpr const auto kSize = "size";
+  constexpr const auto kMaxBufferSize = "buffer";
+
+  po::options_description options_description("Allowed options");
+  options_description.add_options()(kHelp, "Produce help message")(
+      kDelayConfigPath, po::value<std::string>()->required(),
+      "Path to tape delay config")(kSize,
+                                   po::value<size_t>()->default_value(1000),
+                                   "Number of elements to sort")(
+      kMaxBufferSize, po::value<size_t>()->default_value(50),
+      "Max buffer size");
+  po::positional_options_description positionals;
+  positionals.add(kDelayConfigPath, 1);
+
+  try {
+    po::variables_map parsed_variables;
+    po::store(po::command_line_parser(argc, argv)
+                  .options(options_description)
+                  .positional(positionals)
+                  .run(),
+              parsed_variables);
+    if (parsed_variables.count(kHelp) != 0u) {
+      PrintHelpMessage(argv[0], options_description);
+    } else {
+      po::notify(parsed_variables);
+      auto delay_config = ts::TapeDelayConfigParser::Parse(
+          parsed_variables[kDelayConfigPath].as<std::string>());
+      auto size = parsed_variables[kSize].as<size_t>();
+      auto buffer_size = parsed_variables[kMaxBufferSize].as<size_t>();
+
+      RunBenchmark("backward layout", ts::RunLayout::kBackward, delay_config,
+                   size, buffer_size);
+      RunBenchmark("forward layout", ts::RunLayout::kForward, delay_config,
+                   size, buffer_size);
+    }
+  } catch (po::error &e) {
+    std::cerr << "ERROR: " << e.what() << "\n";
+    PrintHelpMessage(argv[0], options_description);
+    return 1;
+  } catch (const std::runtime_error &error) {
+    std::cerr << "ERROR: " << error.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace tape_sorter {
+
+// Pool of page aligned buffers mapped from the system. Released buffers are
+// kept and handed out again, so a steady workload does not allocate. The
+// arena must outlive its buffers. Thread safe.
+class BufferArena {
+ public:
+  class Buffer {
+   public:
+    Buffer() = default;
+
+    Buffer(Buffer&& other) noexcept;
+
+    Buffer& operator=(Buffer&& other) noexcept;
+
+    ~Buffer();
+
+    char* Data() const { return data_; }
+
+    template <typename T>
+    T* Data() const {
+      return reinterpret_cast<T*>(data_);
+    }
+
+    size_t Size() const { return size_; }
+
+    // Gives the memory back to the arena
+    void Release();
+
+   private:
+    friend class BufferArena;
+
+    Buffer(BufferArena* arena, char* data, size_t size, size_t capacity);
+
+   private:
+    BufferArena* arena_{nullptr};
+    char* data_{nullptr};
+    size_t size_{0};
+    size_t capacity_{0};
+  };
+
+  // With huge_pages, buffers are rounded up to 2 MiB and transparent huge
+  // pages are requested for them
+  explicit BufferArena(bool huge_pages = false);
+
+  BufferArena(const BufferArena&) = delete;
+
+  BufferArena& operator=(const BufferArena&) = delete;
+
+  ~BufferArena();
+
+  // Returns a buffer of size bytes at least, its content is unspecified.
+  // Throws std::bad_alloc when the system is out of memory.
+  Buffer Acquire(size_t size);
+
+  // Unmaps the buffers not in use
+  void Trim();
+
+  // Bytes mapped by the arena, in use or not
+  size_t GetMappedBytes() const;
+
+  // Number of mappings made since the creation
+  size_t GetMapsNumber() const;
+
+ private:
+  struct Slot {
+    char* data;
+    size_t capacity;
+  };
+
+ private:
+  void Release(char* data, size_t capacity);
+
+  // Aligned to huge pages when they are requested
+  char* Map(size_t capacity) const;
+
+  size_t RoundUp(size_t size) const;
+
+ private:
+  bool huge_pages_;
+  size_t page_size_;
+  mutable std::mutex mutex_;
+  // Buffers not in use, has room for all the mapped ones, so releasing does
+  // not allocate
+  std::vector<Slot> free_slots_;
+  size_t mapped_buffers_{0};
+  size_t mapped_bytes_{0};
+  size_t maps_number_{0};
+};
+
+}  // namespace tape_sorter
@@ -15,14 +15,40 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <optional>
 
 namespace tape_sorter {
 
+// Model of a drive, its delays are paid on top of the constant ones
+struct TapeLatencyModel {
+  // Paid when the tape starts moving or reverses its direction
+  std::chrono::microseconds start_stop_delay{0};
+  // Per value moved right after a read or a write
+  std::chrono::microseconds streaming_delay{0};
+  // Per value moved without transferring data, i.e. while seeking
+  std::chrono::microseconds repositioning_delay{0};
+  // Per value between the head and the beginning of the tape
+  std::chrono::microseconds rewind_delay_per_value{0};
+};
+
 struct TapeDelayConfig {
   std::chrono::milliseconds read_delay{0};
   std::chrono::milliseconds write_delay{0};
   std::chrono::milliseconds move_delay{0};
   std::chrono::milliseconds rewind_delay{0};
+  // Moving backward is often slower than streaming forward, move_delay is
+  // used when it is not set
+  std::optional<std::chrono::milliseconds> move_backward_delay;
+  TapeLatencyModel latency_model;
+  // Every delay is scaled by a random factor within [1 - jitter, 1 + jitter]
+  double jitter{0};
+  // Seed of the jitter, tapes with the same seed see the same factors
+  uint64_t seed{0};
+
+  std::chrono::milliseconds GetMoveBackwardDelay() const {
+    return move_backward_delay.value_or(move_delay);
+  }
 };
 
 }  // namespace tape_sorter
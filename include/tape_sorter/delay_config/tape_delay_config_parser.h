@@ -29,6 +29,18 @@ class TapeDelayConfigParser {
   constexpr static const auto kReadDelayKey = "read_delay";
   constexpr static const auto kWriteDelayKey = "write_delay";
   constexpr static const auto kRewindDelayKey = "rewind_delay";
+  // optional
+  constexpr static const auto kMoveBackwardDelayKey = "move_backward_delay";
+  // optional latency model, in microseconds
+  constexpr static const auto kStartStopDelayKey = "start_stop_delay_us";
+  constexpr static const auto kStreamingDelayKey = "streaming_delay_us";
+  constexpr static const auto kRepositioningDelayKey =
+      "repositioning_delay_us";
+  constexpr static const auto kRewindDelayPerValueKey =
+      "rewind_delay_per_value_us";
+  // optional jitter, a fraction from 0 to 1, and its seed
+  constexpr static const auto kJitterKey = "jitter";
+  constexpr static const auto kSeedKey = "seed";
 
  public:
   static TapeDelayConfig Parse(const fs::path& config_path);
@@ -14,21 +14,48 @@
 
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <thread>
+#include <memory>
+#include <random>
 
+#include "tape_sorter/buffer_arena.h"
 #include "tape_sorter/delay_config/tape_delay_config.h"
+#include "tape_sorter/file_tape_backend.h"
+#include "tape_sorter/file_tape_format.h"
 #include "tape_sorter/tape_interface.h"
+#include "tape_sorter/tape_operation_counts.h"
 
 namespace tape_sorter {
 
 namespace fs = std::filesystem;
 
+class IFileTapeStorage;
+class FramedFileStorage;
+
 class FileTape : public ITape {
  public:
-  FileTape(const fs::path& file_path, TapeDelayConfig config = {});
+  // Tapes sharing operation_counts accumulate their operations together. The
+  // buffers of the tape are taken from buffer_arena, a private arena is used
+  // when it is null.
+  //
+  // The format is used for an empty file, an existing one is read in the
+  // format it was written in. Throws std::runtime_error when a framed file
+  // is corrupted.
+  FileTape(const fs::path& file_path, TapeDelayConfig config = {},
+           FileTapeBackend backend = FileTapeBackend::kStream,
+           std::shared_ptr<TapeOperationCounts> operation_counts =
+               std::make_shared<TapeOperationCounts>(),
+           std::shared_ptr<BufferArena> buffer_arena = nullptr,
+           FileTapeFormat format = FileTapeFormat::kRaw);
+
+  FileTape(FileTape&&) noexcept;
+
+  FileTape& operator=(FileTape&&) noexcept;
+
+  ~FileTape() override;
 
   std::optional<int> Read() override;
 
@@ -40,15 +67,69 @@ class FileTape : public ITape {
 
   void Rewind() override;
 
+  std::optional<int> ReadForward() override;
+
+  std::optional<int> ReadBackward() override;
+
+  void WriteForward(int value) override;
+
+  // Moves the head to the value at the position, or just past the last
+  // value, in one locate at the speed of a rewind. Throws std::out_of_range
+  // beyond the end of the tape.
+  void Seek(uint64_t position) override;
+
+  // Nullopt while the head is before the first value after reading backward
+  std::optional<uint64_t> GetPosition() const override;
+
+  // Known for a framed file, unless values were overwritten since the last
+  // flush. Reading it takes no tape motion.
+  std::optional<TapeMetadata> GetMetadata() const override;
+
+  FileTapeFormat GetFormat() const;
+
+  // Whether the values match the checksums stored with them, always true for
+  // a raw file. Flushes the tape and reads the file without moving the head.
+  bool VerifyChecksums();
+
+  const TapeOperationCounts& GetOperationCounts() const;
+
+  // Upper bound of the memory in bytes a tape with the backend keeps for its
+  // buffers
+  static size_t GetMemoryUsage(FileTapeBackend backend);
+
+  // Makes the written values visible to other readers of the file, happens
+  // on destruction as well. A framed file gets its header and checksums
+  // written, which takes a scan of the file once values were overwritten.
+  void Flush();
+
  private:
-  void UpdatePosition(std::streampos position);
+  // Reads the current value without paying the read delay
+  std::optional<int> ReadValue();
+
+  void Shift(int64_t offset);
+
+  // Delay of a move by offset, updates the state of the head
+  std::chrono::microseconds GetMoveDelay(int64_t offset);
+
+  void Delay(std::chrono::microseconds delay);
 
  private:
-  std::fstream tape_stream_;
-  std::streampos current_position_{std::fstream::beg};
+  std::unique_ptr<IFileTapeStorage> storage_;
+  // The storage of a framed file, null for a raw one
+  FramedFileStorage* framed_storage_;
+  // Index of the value under the head
+  int64_t position_{0};
   TapeDelayConfig delay_config_;
+  // Direction of the last move, 0 when the tape is stopped
+  int direction_{0};
+  // Whether a value has been read or written since the last move
+  bool is_streaming_{false};
+  std::minstd_rand random_generator_;
+  // Delays shorter than a sleep are accumulated
+  std::chrono::microseconds pending_delay_{0};
+  std::shared_ptr<TapeOperationCounts> operation_counts_;
   // boundary marker
-  static std::streampos before_begin;
+  static constexpr int64_t kBeforeBegin = -1;
 };
 
 }  // namespace tape_sorter
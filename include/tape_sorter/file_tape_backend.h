@@ -0,0 +1,29 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+namespace tape_sorter {
+
+// How FileTape accesses its file
+enum class FileTapeBackend {
+  // std::fstream, every operation goes through the page cache
+  kStream,
+  // O_DIRECT with aligned blocks, read-ahead and write-behind keep several
+  // requests in flight through io_uring, or are done with pread/pwrite when
+  // io_uring is unavailable
+  kDirect,
+};
+
+}  // namespace tape_sorter
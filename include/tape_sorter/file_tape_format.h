@@ -0,0 +1,29 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+namespace tape_sorter {
+
+// Layout of the file of a FileTape
+enum class FileTapeFormat {
+  // The values only, as they are laid out in memory
+  kRaw,
+  // A header of 64 bytes, the values, then a CRC-32 of every block of 4096
+  // values. The header holds the format version, the element type and size,
+  // the number of values, their min, max and order, and a CRC-32 of its own.
+  kFramed,
+};
+
+}  // namespace tape_sorter
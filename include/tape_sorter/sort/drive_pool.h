@@ -0,0 +1,99 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "tape_sorter/sort/temp_tape_creator_interface.h"
+
+namespace tape_sorter {
+
+struct DrivePoolConfig {
+  size_t drives_number{3};
+  std::chrono::milliseconds mount_delay{0};
+  std::chrono::milliseconds unmount_delay{0};
+};
+
+enum class DriveEventKind { kMount, kUnmount };
+
+struct DriveEvent {
+  DriveEventKind kind;
+  size_t drive;
+  // Number of the tape in the order of creation
+  size_t cartridge;
+};
+
+// Tapes of the wrapped creator are cartridges, which have to be mounted on
+// one of a few drives to be used. A cartridge is mounted on its first
+// operation, taking the place of the least recently used one when every
+// drive is busy, and is unmounted when destroyed. Mount costs are modeled,
+// not slept. The pool must outlive its tapes.
+class DrivePool : public ITempTapeCreator {
+ public:
+  // Throws std::invalid_argument without drives
+  DrivePool(std::unique_ptr<ITempTapeCreator> temp_tape_creator,
+            DrivePoolConfig config);
+
+  std::unique_ptr<ITape> Create() override;
+
+  // Passes the cartridges read on to the wrapped creator
+  std::unique_ptr<ITape> CreateForMerge(
+      const std::vector<const ITape*>& source_tapes) override;
+
+  size_t GetTapeMemoryUsage() const override;
+
+  void SetBufferArena(std::shared_ptr<BufferArena> buffer_arena) override;
+
+  size_t GetMaxMountedTapes() const override;
+
+  bool TakesDrive(const ITape& tape) const override;
+
+  bool IsMounted(const ITape& tape) const override;
+
+  // Time of the wrapped tapes and of mounting
+  std::chrono::microseconds GetModeledTime() const override;
+
+  size_t GetMountsNumber() const;
+
+  const std::vector<DriveEvent>& GetSchedule() const;
+
+ private:
+  class CartridgeTape;
+
+  struct Drive {
+    std::optional<size_t> cartridge;
+    uint64_t last_use{0};
+  };
+
+ private:
+  void Mount(size_t cartridge);
+
+  void Unmount(size_t cartridge);
+
+ private:
+  std::unique_ptr<ITempTapeCreator> temp_tape_creator_;
+  DrivePoolConfig config_;
+  std::vector<Drive> drives_;
+  uint64_t clock_{0};
+  size_t cartridges_number_{0};
+  size_t mounts_number_{0};
+  std::chrono::microseconds mount_time_{0};
+  std::vector<DriveEvent> schedule_;
+};
+
+}  // namespace tape_sorter
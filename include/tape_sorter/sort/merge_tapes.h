@@ -0,0 +1,171 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "tape_sorter/sort/run_layout.h"
+#include "tape_sorter/sort/sort_stability.h"
+#include "tape_sorter/sort/tapes_priority_queue.h"
+#include "tape_sorter/sort/temp_tape_creator_interface.h"
+#include "tape_sorter/tape_interface.h"
+
+namespace tape_sorter {
+
+enum class DuplicatePolicy {
+  kKeep,
+  // Only the first of equivalent values is written
+  kDrop,
+};
+
+struct MergeOptions {
+  // Layout of the values on every input tape, the heads must be on the
+  // minimal values: at the beginning for kForward, at the end for kBackward
+  RunLayout input_layout{RunLayout::kForward};
+  // Maximal number of tapes merged at once, 0 means unbounded. Larger inputs
+  // are merged in several passes through temporary tapes
+  size_t max_fan_in{0};
+  DuplicatePolicy duplicate_policy{DuplicatePolicy::kKeep};
+};
+
+// Merges the input tapes, sorted by comparator, into the output tape from its
+// current position. temp_tape_creator is required when there are more input
+// tapes than max_fan_in. With SortStability::kStable equivalent values are
+// written in the order of their input tapes.
+template <typename Comparator = std::less<int>,
+          SortStability kStability = SortStability::kUnstable>
+void MergeTapes(const std::vector<ITape*>& input_tapes, ITape& output_tape,
+                const MergeOptions& options = {},
+                ITempTapeCreator* temp_tape_creator = nullptr,
+                Comparator comparator = {});
+
+// Same for input tapes with different layouts, options.input_layout is
+// ignored
+template <typename Comparator = std::less<int>,
+          SortStability kStability = SortStability::kUnstable>
+void MergeSources(const std::vector<MergeSource>& sources, ITape& output_tape,
+                  const MergeOptions& options = {},
+                  ITempTapeCreator* temp_tape_creator = nullptr,
+                  Comparator comparator = {});
+
+// IMPLEMENTATION
+
+namespace detail {
+
+template <typename Comparator, SortStability kStability>
+void MergePass(const std::vector<MergeSource>& sources, ITape& output_tape,
+               DuplicatePolicy duplicate_policy, const Comparator& comparator) {
+  TapesPriorityQueue<Comparator, kStability> tapes_queue{sources, comparator};
+  std::optional<int> last_value;
+
+  while (!tapes_queue.Empty()) {
+    auto min = tapes_queue.Top();
+    tapes_queue.Pop();
+    // The values come in order, so the last one is not greater
+    if (duplicate_policy == DuplicatePolicy::kDrop && last_value &&
+        !comparator(last_value.value(), min)) {
+      continue;
+    }
+    output_tape.WriteForward(min);
+    last_value = min;
+  }
+}
+
+}  // namespace detail
+
+template <typename Comparator, SortStability kStability>
+void MergeTapes(const std::vector<ITape*>& input_tapes, ITape& output_tape,
+                const MergeOptions& options,
+                ITempTapeCreator* temp_tape_creator, Comparator comparator) {
+  std::vector<MergeSource> sources;
+  sources.reserve(input_tapes.size());
+  for (auto* tape : input_tapes) {
+    sources.push_back({tape, options.input_layout});
+  }
+  MergeSources<Comparator, kStability>(sources, output_tape, options,
+                                       temp_tape_creator,
+                                       std::move(comparator));
+}
+
+template <typename Comparator, SortStability kStability>
+void MergeSources(const std::vector<MergeSource>& input_sources,
+                  ITape& output_tape, const MergeOptions& options,
+                  ITempTapeCreator* temp_tape_creator, Comparator comparator) {
+  auto sources = input_sources;
+  auto fan_in = options.max_fan_in == 0 ? sources.size() : options.max_fan_in;
+  if (sources.size() > fan_in) {
+    if (fan_in < 2) {
+      throw std::invalid_argument("Fan-in must be at least 2\n");
+    }
+    if (temp_tape_creator == nullptr) {
+      throw std::invalid_argument(
+          "Temporary tape creator is required to merge more tapes than the "
+          "fan-in\n");
+    }
+  }
+
+  std::vector<std::unique_ptr<ITape>> temp_tapes;
+  // The first pass is shortened, so that the last one merges exactly fan_in
+  // tapes and no pass merges fewer tapes than needed
+  auto pass_size = sources.size() > fan_in
+                       ? (sources.size() - 2) % (fan_in - 1) + 2
+                       : sources.size();
+  // A pass replaces adjacent sources with their merge, so the sources stay in
+  // the input order. The passes go round the sources to keep them balanced.
+  size_t position = 0;
+  while (sources.size() > fan_in) {
+    if (position + pass_size > sources.size()) {
+      position = 0;
+    }
+    auto pass_begin = sources.begin() + position;
+    std::vector<MergeSource> pass_sources(pass_begin, pass_begin + pass_size);
+
+    std::vector<const ITape*> pass_tapes;
+    for (const auto& source : pass_sources) {
+      pass_tapes.push_back(source.tape);
+    }
+    auto temp_tape = temp_tape_creator->CreateForMerge(pass_tapes);
+    detail::MergePass<Comparator, kStability>(
+        pass_sources, *temp_tape, options.duplicate_policy, comparator);
+    temp_tape->Rewind();
+    *pass_begin = {temp_tape.get(), RunLayout::kForward};
+    sources.erase(pass_begin + 1, pass_begin + pass_size);
+    temp_tapes.push_back(std::move(temp_tape));
+    ++position;
+
+    // Merged temporary tapes are not needed anymore
+    temp_tapes.erase(
+        std::remove_if(temp_tapes.begin(), temp_tapes.end(),
+                       [&pass_sources](const auto& tape) {
+                         return std::any_of(
+                             pass_sources.begin(), pass_sources.end(),
+                             [&tape](const MergeSource& source) {
+                               return source.tape == tape.get();
+                             });
+                       }),
+        temp_tapes.end());
+    pass_size = fan_in;
+  }
+
+  detail::MergePass<Comparator, kStability>(
+      sources, output_tape, options.duplicate_policy, comparator);
+}
+
+}  // namespace tape_sorter
@@ -0,0 +1,28 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+namespace tape_sorter {
+
+// Layout of the sorted runs on the temporary tapes
+enum class RunLayout {
+  // Runs are written in reverse order and merged moving backward from their
+  // ends, no rewinds are needed
+  kBackward,
+  // Runs are written in order, rewound once and merged moving forward
+  kForward,
+};
+
+}  // namespace tape_sorter
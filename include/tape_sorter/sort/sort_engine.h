@@ -0,0 +1,46 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+namespace tape_sorter {
+
+// Algorithm a TapeSorter sorts an input larger than a block with
+enum class SortEngine {
+  // Blocks sorted in memory into runs on temporary tapes, merged into the
+  // output tape
+  kMerge,
+  // Values scattered into bucket tapes between splitters sampled from the
+  // first block, then each bucket sorted in memory and appended to the
+  // output tape. Every value is written and read once, sequentially, when
+  // the buckets fit a block; a larger bucket is distributed once more, and
+  // sorted by runs below that.
+  kDistribution,
+  // Occurrences of every key of a bounded range counted in memory, then the
+  // keys written to the output tape as many times as they occurred, without
+  // temporary tapes. A range larger than the memory is counted a partition
+  // per pass over an input which seeks back to where it started, while the
+  // passes read no more than the merge writes and reads. The input is merged
+  // instead when the range is unknown or takes more passes, unless
+  // SortOptions::strict_engine is set. For std::less and std::greater only.
+  kCounting,
+};
+
+// Inclusive range of the values of an input
+struct KeyRange {
+  int min;
+  int max;
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,121 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "tape_sorter/buffer_arena.h"
+#include "tape_sorter/sort/tape_sorter.h"
+#include "tape_sorter/thread_pool.h"
+
+namespace tape_sorter {
+
+struct SortServiceConfig {
+  size_t threads_number{std::max(std::thread::hardware_concurrency(), 1u)};
+  // Shared by the running jobs
+  MemoryBudget memory_budget{256 << 20};
+  // Least memory of a running job, its temporary tapes are kept within half
+  // of it. Together with the threads it bounds the jobs running at once.
+  size_t min_job_memory{16 << 20};
+};
+
+enum class SortJobState { kQueued, kRunning, kDone, kFailed };
+
+using SortJobId = size_t;
+
+struct SortJobStatus {
+  SortJobState state;
+  size_t values_read;
+  size_t values_written;
+  // Memory the blocks of the job may take now, 0 unless running
+  size_t granted_memory;
+  // Since the job started running
+  std::chrono::nanoseconds elapsed_time;
+  // Values read and written per second, both count
+  double values_per_second;
+};
+
+// Runs sort jobs on a shared thread pool within one memory budget. Jobs are
+// admitted in order while every running one gets min_job_memory at least
+// and a thread to run on. The budget is split evenly between the running
+// jobs and split again whenever a job starts or finishes, a job sees its new
+// share at its next block. The budget is a soft limit: until the running jobs
+// reach their next blocks, sized from their former shares, the blocks of the
+// jobs admitted meanwhile come on top of the budget.
+// The parallel parts of the block sorts run on the same pool. Thread safe.
+class SortService {
+ public:
+  // Throws std::invalid_argument when the budget does not fit a job
+  explicit SortService(SortServiceConfig config = {});
+
+  SortService(const SortService&) = delete;
+
+  SortService& operator=(const SortService&) = delete;
+
+  // Waits for the jobs
+  ~SortService();
+
+  // Sorts the input tape into the output one in ascending order. The tapes
+  // are not owned and must outlive the job. The memory budget, the buffer
+  // arena, the thread pool and the progress of the options are set by the
+  // service.
+  SortJobId Submit(ITape& input_tape, ITape& output_tape,
+                   std::unique_ptr<ITempTapeCreator> temp_tape_creator =
+                       std::make_unique<TempFileTapeCreator>(),
+                   SortOptions options = {});
+
+  // Throws std::out_of_range for an unknown job
+  SortJobStatus GetStatus(SortJobId job_id) const;
+
+  // Waits for the job and returns its statistics, rethrows its error
+  SortStatistics Wait(SortJobId job_id);
+
+  void WaitAll();
+
+  size_t GetRunningJobsNumber() const;
+
+ private:
+  struct Job;
+
+ private:
+  // Both expect the mutex to be held
+  void AdmitJobs();
+
+  void SplitMemory();
+
+  void RunJob(Job& job);
+
+ private:
+  SortServiceConfig config_;
+  size_t max_running_jobs_number_;
+  std::shared_ptr<BufferArena> buffer_arena_;
+  mutable std::mutex mutex_;
+  std::condition_variable job_finished_;
+  std::vector<std::unique_ptr<Job>> jobs_;
+  std::deque<Job*> queued_jobs_;
+  std::vector<Job*> running_jobs_;
+  // Destroyed first, so the running jobs finish before the rest
+  std::shared_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,29 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+namespace tape_sorter {
+
+// Order of the values the comparator finds equivalent
+enum class SortStability {
+  // Equivalent values may come out in any order
+  kUnstable,
+  // Equivalent values keep the order of the input: blocks are sorted with
+  // std::stable_sort, and merges take equivalent values from the earlier
+  // tape first
+  kStable,
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,65 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace tape_sorter {
+
+// Order independent summary of a multiset of values: sorting must not change
+// it
+struct MultisetChecksum {
+  size_t count{0};
+  // Sum of the mixed values modulo 2^64
+  uint64_t hash{0};
+  int min{std::numeric_limits<int>::max()};
+  int max{std::numeric_limits<int>::min()};
+
+  void Add(int value) {
+    ++count;
+    hash += Mix(static_cast<uint32_t>(value));
+    min = value < min ? value : min;
+    max = value > max ? value : max;
+  }
+
+  bool operator==(const MultisetChecksum& other) const {
+    return count == other.count && hash == other.hash && min == other.min &&
+           max == other.max;
+  }
+
+  bool operator!=(const MultisetChecksum& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  // splitmix64 finalizer
+  static uint64_t Mix(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+  }
+};
+
+// The output of a sort is not an ordered permutation of its input
+class SortVerificationError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+}  // namespace tape_sorter
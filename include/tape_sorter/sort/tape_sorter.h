@@ -15,30 +15,874 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
 #include <memory>
-#include <queue>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "tape_sorter/buffer_arena.h"
+#include "tape_sorter/sparse_index.h"
+#include "tape_sorter/sort/merge_tapes.h"
+#include "tape_sorter/sort/run_layout.h"
+#include "tape_sorter/sort/sort_engine.h"
+#include "tape_sorter/sort/sort_stability.h"
+#include "tape_sorter/sort/sort_verification.h"
 #include "tape_sorter/sort/temp_file_tape_creator.h"
+#include "tape_sorter/sort/verifying_tape.h"
 #include "tape_sorter/tape_interface.h"
+#include "tape_sorter/thread_pool.h"
+#include "tape_sorter/write_behind_tape.h"
 
 namespace tape_sorter {
 
-class TapeSorter final {
+// Memory available to a sort, in bytes
+struct MemoryBudget {
+  size_t bytes;
+};
+
+// Memory a scheduler lets a sort use, it may change while the sort runs
+class MemoryGrant {
  public:
+  explicit MemoryGrant(size_t bytes) : bytes_(bytes) {}
+
+  size_t GetBytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+  void SetBytes(size_t bytes) {
+    bytes_.store(bytes, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<size_t> bytes_;
+};
+
+// Updated by a running sort, may be read from other threads
+struct SortProgress {
+  // Values read from the input, a block at a time
+  std::atomic<size_t> values_read{0};
+  // Values written to the output, published every few thousands
+  std::atomic<size_t> values_written{0};
+};
+
+struct SortOptions {
+  RunLayout run_layout{RunLayout::kBackward};
+  // The checksum of the input is computed during run generation and compared
+  // with the one of the output as it is written. SortVerificationError is
+  // thrown when the output is not sorted or is not a permutation of the
+  // input.
+  bool verify{false};
+  // Threads sorting each block in memory. With more than one, or for a
+  // stable sort, a scratch buffer of the block size is needed as well
+  size_t threads_number{1};
+  // The blocks sorted in memory and the buffers of the temporary tapes are
+  // taken from the arena and given back to it, so sorting more data or
+  // sorting again reuses the same memory. The sorter creates its own when
+  // null.
+  std::shared_ptr<BufferArena> buffer_arena;
+  // Runs the parallel parts of the block sort when set, threads are started
+  // for them otherwise
+  std::shared_ptr<ThreadPool> thread_pool;
+  // With a memory budget, the blocks may take up to the grant when it is
+  // larger than the budget, the runs stay within the budget. It is read
+  // before each block.
+  std::shared_ptr<const MemoryGrant> memory_grant;
+  std::shared_ptr<SortProgress> progress;
+  // Values buffered between the final merge and a writer thread writing them
+  // to the output tape, so the merge does not wait for the write delays. 0
+  // writes them on the merging thread. The output tape is written from the
+  // writer thread then. The ring comes from the arena and out of the block
+  // memory of a budget.
+  size_t write_behind_buffer_size{0};
+  // Cleared and filled with every stride-th value written to the output tape,
+  // the positions count from the head of the output tape at the start of the
+  // sort
+  std::shared_ptr<SparseIndex> sparse_index;
+  // Keeps the last block of the input, sorted in memory, as a run read by the
+  // merge from memory instead of a temporary tape. The end of the input is
+  // probed after each full block. An input fitting one block then goes from
+  // the block to the output tape.
+  bool keep_tail_run_in_memory{false};
+  SortEngine engine{SortEngine::kMerge};
+  // Values of the input for SortEngine::kCounting, a value out of it throws
+  // std::out_of_range. Taken from the metadata of the input when it is not
+  // set, the input is sorted by the merge when neither tells it.
+  std::optional<KeyRange> key_range;
+  // Throws std::invalid_argument from Sort instead of falling back to the
+  // merge when SortEngine::kCounting does not fit the input
+  bool strict_engine{false};
+};
+
+enum class SortStepKind {
+  // A block sorted in memory and written to a temporary tape
+  kRun,
+  // Runs merged into a temporary tape, during run generation or to fit the
+  // final merge into the drives
+  kEarlyMerge,
+  // Runs merged into the output tape
+  kFinalMerge,
+  // Values of an input known to be in order copied to the output tape
+  kCopy,
+  // Values of the input distributed into bucket tapes
+  kScatter,
+  // Values of a partition of the key range counted in a pass over the input
+  // and written to the output tape
+  kCount,
+};
+
+struct SortStep {
+  SortStepKind kind;
+  // Runs merged, 1 for a run
+  size_t tapes_number;
+  size_t values_number;
+};
+
+struct SortStatistics {
+  // Engine which sorted the input. SortEngine::kMerge as well for an input
+  // copied or sorted in memory, or when the counting engine does not fit it.
+  SortEngine engine{SortEngine::kMerge};
+  size_t values_number{0};
+  // Runs sorted in memory
+  size_t runs_number{0};
+  size_t early_merges_number{0};
+  // Includes the early merges
+  std::chrono::nanoseconds run_generation_time{0};
+  std::chrono::nanoseconds merge_time{0};
+  // Steps in the order they were done
+  std::vector<SortStep> schedule;
+  // Time spent by the temporary tapes by the delay model, see
+  // ITempTapeCreator::GetModeledTime
+  std::chrono::microseconds modeled_time{0};
+};
+
+// Part of TapeSorter independent of the order of the values
+class TapeSorterBase {
+ protected:
+  struct Run {
+    std::unique_ptr<ITape> tape;
+    RunLayout layout;
+    // Number of merges the values went through
+    size_t level;
+    size_t values_number;
+  };
+
+  struct CountingPlan {
+    KeyRange key_range;
+    // Values read from the input at once
+    size_t chunk_size;
+    // Keys counted in a pass over the input
+    uint64_t partition_size;
+  };
+
+  using Clock = std::chrono::steady_clock;
+
+  // Smaller blocks are not worth the threads
+  static constexpr size_t kMinParallelSortSize = 1 << 16;
+
+ protected:
+  TapeSorterBase(size_t max_buffer_size,
+                 std::unique_ptr<ITempTapeCreator> temp_tape_creator,
+                 SortOptions options);
+
+  TapeSorterBase(MemoryBudget memory_budget,
+                 std::unique_ptr<ITempTapeCreator> temp_tape_creator,
+                 SortOptions options);
+
+  size_t GetBlockSize(size_t runs_number) const;
+
+  // First and number of the adjacent runs of the lowest level, as many as a
+  // merge may read, preferring the ones whose tapes are mounted. A lone run
+  // is taken with a neighbour.
+  std::pair<size_t, size_t> GetShortestRuns(const std::vector<Run>& runs) const;
+
+  // Runs on tapes which take a drive, not the ones kept in memory
+  size_t GetDriveRunsNumber(const std::vector<Run>& runs) const;
+
+  // Puts the merge of the runs_number runs from first in their place
+  static void ReplaceRuns(std::vector<Run>& runs, size_t first,
+                          size_t runs_number, std::unique_ptr<ITape> tape,
+                          SortStatistics& statistics);
+
+  static std::vector<MergeSource> GetSources(const std::vector<Run>& runs,
+                                             size_t first, size_t runs_number);
+
+  // Returns the number of values read
+  static size_t ReadBlock(ITape& input_tape, int* block, size_t buffer_size);
+
+  static void WriteBlock(ITape& tape, const int* block, size_t size);
+
+  static void WriteBlockReversed(ITape& tape, const int* block, size_t size);
+
+  // Run read forward from the sorted values of the buffer
+  static std::unique_ptr<ITape> CreateMemoryRun(BufferArena::Buffer buffer,
+                                                size_t size);
+
+  // Adds values read from the input to the progress and, when verifying, to
+  // the checksum
+  void CountInputValues(const int* values, size_t size,
+                        MultisetChecksum& input_checksum) const;
+
+  // Buckets of a distribution sort of the input, values_number is known for
+  // a tape with metadata and for a bucket. The open tapes, e.g. buckets not
+  // sorted yet, are left out of the temporary tapes written at once.
+  size_t GetBucketsNumber(std::optional<uint64_t> values_number,
+                          size_t open_tapes_number) const;
+
+  void CopyValues(ITape& input_tape, ITape& output_tape,
+                  MultisetChecksum& input_checksum,
+                  SortStatistics& statistics) const;
+
+  // Merge passes over the values of an input, each one writes and reads them
+  // once. An input of unknown size is taken to be merged in one pass.
+  size_t GetMergeLevelsNumber(std::optional<uint64_t> values_number) const;
+
+  // Counting sort of the input, nullopt for another engine or when the merge
+  // does better: without a key range, or when the counts take more passes
+  // than the merge moves the values. Only an input which seeks back to its
+  // position is read more than once. Throws std::invalid_argument instead of
+  // nullopt for a strict engine.
+  std::optional<CountingPlan> PlanCounting(
+      const std::optional<TapeMetadata>& metadata, bool is_seekable) const;
+
+  // Counts the keys of the range a partition at a time, seeking the head of
+  // the input back to where it started between the passes, and writes each
+  // partition to the output tape in ascending or descending order
+  void SortByCounting(ITape& input_tape, ITape& output_tape,
+                      const CountingPlan& plan, bool is_descending,
+                      MultisetChecksum& input_checksum,
+                      SortStatistics& statistics) const;
+
+  // Calls task(i) for every i below tasks_number, on the thread pool of the
+  // options or each on its own thread but the first one
+  template <typename Task>
+  void RunInParallel(size_t tasks_number, Task task) const;
+
+  class ProgressTape;
+
+ protected:
+  std::optional<MemoryBudget> memory_budget_;
+  size_t max_buffer_size_{0};
+  // Open temporary tapes are bounded by the memory budget and the file
+  // descriptors limit
+  size_t max_runs_number_;
+  // Bounded by the drives the temporary tapes are mounted on
+  size_t max_merge_ways_{std::numeric_limits<size_t>::max()};
+  std::unique_ptr<ITempTapeCreator> temp_tape_creator_;
+  SortOptions options_;
+  // A stable sort of a block merges through a scratch buffer
+  SortStability stability_{SortStability::kUnstable};
+};
+
+// Sorts the values in the order of Comparator, a strict weak ordering as for
+// std::sort, ascending by default. The comparator is a template parameter, so
+// it is inlined in the sort of the blocks and in the merges.
+template <typename Comparator = std::less<int>,
+          SortStability kStability = SortStability::kUnstable>
+class TapeSorter final : private TapeSorterBase {
+ public:
+  // Sorts blocks of max_buffer_size values in memory, the memory kept by the
+  // temporary tapes is not limited.
+  //
+  // When the creator can mount only a few tapes at once, e.g. a DrivePool, a
+  // merge into one of its tapes reads one tape less than that, and runs are
+  // merged in passes, the mounted ones first, until the final merge fits.
+  // The final merge into another tape reads as many tapes as can be
+  // mounted, and runs kept in memory take no drive. Throws std::invalid_argument when fewer than
+  // three tapes can be mounted, or when the counting engine is chosen for
+  // another comparator than std::less and std::greater or an empty key range.
   TapeSorter(size_t max_buffer_size,
              std::unique_ptr<ITempTapeCreator> temp_tape_creator =
-                 std::make_unique<TempFileTapeCreator>());
+                 std::make_unique<TempFileTapeCreator>(),
+             SortOptions options = {}, Comparator comparator = {});
+
+  // The budget is shared by the blocks sorted in memory and the buffers of
+  // the temporary tapes, as reported by the creator. Each block takes what
+  // the existing runs leave. Once the runs would take more than half of the
+  // budget, the shortest of them are merged early, so the final merge is
+  // done in one pass within the budget. Throws std::invalid_argument when
+  // the budget does not fit a few temporary tapes.
+  TapeSorter(MemoryBudget memory_budget,
+             std::unique_ptr<ITempTapeCreator> temp_tape_creator =
+                 std::make_unique<TempFileTapeCreator>(),
+             SortOptions options = {}, Comparator comparator = {});
 
-  void Sort(ITape& input_tape, ITape& output_tape) const;
+  // An input tape whose metadata shows it in order is copied, one whose
+  // values fit a block is sorted in memory and written to the output tape
+  // directly.
+  SortStatistics Sort(ITape& input_tape, ITape& output_tape) const;
 
  private:
-  std::vector<std::unique_ptr<ITape>> SplitIntoSortedSubTapes(
-      ITape& input_tape) const;
+  // The order of std::less and std::greater, kNone for other comparators
+  static constexpr SortOrder GetComparatorOrder();
+
+  // Whether the values are known to be in the order of the comparator
+  static bool IsInOrder(const TapeMetadata& metadata);
+
+  void SortInMemory(ITape& input_tape, ITape& output_tape,
+                    size_t values_number, MultisetChecksum& input_checksum,
+                    SortStatistics& statistics) const;
+
+  // Splits the input into sorted runs on temporary tapes and merges them.
+  // The input checksum is null for a bucket, its values were counted when
+  // they were read from the input. The open tapes, e.g. the buckets not
+  // sorted yet, take their memory and descriptors from the runs.
+  void SortWithRuns(ITape& input_tape, ITape& output_tape,
+                    MultisetChecksum* input_checksum, size_t open_tapes_number,
+                    SortStatistics& statistics) const;
+
+  std::vector<Run> SplitIntoSortedSubTapes(ITape& input_tape,
+                                           MultisetChecksum* input_checksum,
+                                           size_t open_tapes_number,
+                                           SortStatistics& statistics) const;
+
+  // Scatters the input into buckets between splitters sampled from its first
+  // block, then sorts each bucket in memory, and appends it to the output
+  // tape. A bucket which outgrew a block is distributed once more, or sorted
+  // by runs when it is a bucket of a bucket. The input checksum is null for a
+  // bucket.
+  void SortByDistribution(ITape& input_tape, ITape& output_tape,
+                          std::optional<uint64_t> values_number,
+                          MultisetChecksum* input_checksum,
+                          size_t open_tapes_number,
+                          SortStatistics& statistics) const;
+
+  // Splitters between buckets, equivalent ones are merged
+  std::vector<int> ChooseSplitters(const int* block, size_t size,
+                                   size_t buckets_number) const;
+
+  void SortBlock(int* block, size_t size) const;
+
+  // A stable sort merges through the scratch, as large as the range
+  void SortRange(int* begin, int* end, int* scratch) const;
+
+  // Merges the runs of the lowest level, as many as a merge may read and
+  // mounted ones first, into one run of the next level
+  void MergeShortestRuns(std::vector<Run>& runs,
+                         SortStatistics& statistics) const;
 
  private:
-  size_t max_buffer_size_;
-  std::unique_ptr<ITempTapeCreator> temp_tape_creator_;
+  Comparator comparator_;
 };
 
+// IMPLEMENTATION
+
+// Counts the values written forward through it into SortProgress
+class TapeSorterBase::ProgressTape : public ITape {
+ public:
+  ProgressTape(ITape& tape, SortProgress& progress)
+      : tape_(tape), progress_(progress) {}
+
+  ~ProgressTape() override { Publish(); }
+
+  std::optional<int> Read() override { return tape_.Read(); }
+
+  void Write(int value) override { tape_.Write(value); }
+
+  bool MoveForward() override { return tape_.MoveForward(); }
+
+  bool MoveBackward() override { return tape_.MoveBackward(); }
+
+  void Rewind() override { tape_.Rewind(); }
+
+  void WriteForward(int value) override {
+    tape_.WriteForward(value);
+    if (++pending_values_number_ == kPublishPeriod) {
+      Publish();
+    }
+  }
+
+  void Publish() {
+    progress_.values_written += pending_values_number_;
+    pending_values_number_ = 0;
+  }
+
+ private:
+  static constexpr size_t kPublishPeriod = 4096;
+
+ private:
+  ITape& tape_;
+  SortProgress& progress_;
+  size_t pending_values_number_{0};
+};
+
+template <typename Task>
+void TapeSorterBase::RunInParallel(size_t tasks_number, Task task) const {
+  if (options_.thread_pool) {
+    options_.thread_pool->ParallelFor(tasks_number, task);
+    return;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(tasks_number);
+  for (size_t i = 1; i < tasks_number; ++i) {
+    threads.emplace_back(task, i);
+  }
+  task(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+template <typename Comparator, SortStability kStability>
+TapeSorter<Comparator, kStability>::TapeSorter(
+    size_t max_buffer_size, std::unique_ptr<ITempTapeCreator> temp_tape_creator,
+    SortOptions options, Comparator comparator)
+    : TapeSorterBase(max_buffer_size, std::move(temp_tape_creator),
+                     std::move(options)),
+      comparator_(std::move(comparator)) {
+  stability_ = kStability;
+  if (options_.engine == SortEngine::kCounting &&
+      GetComparatorOrder() == SortOrder::kNone) {
+    throw std::invalid_argument(
+        "Counting sorts for std::less and std::greater only\n");
+  }
+}
+
+template <typename Comparator, SortStability kStability>
+TapeSorter<Comparator, kStability>::TapeSorter(
+    MemoryBudget memory_budget,
+    std::unique_ptr<ITempTapeCreator> temp_tape_creator, SortOptions options,
+    Comparator comparator)
+    : TapeSorterBase(memory_budget, std::move(temp_tape_creator),
+                     std::move(options)),
+      comparator_(std::move(comparator)) {
+  stability_ = kStability;
+  if (options_.engine == SortEngine::kCounting &&
+      GetComparatorOrder() == SortOrder::kNone) {
+    throw std::invalid_argument(
+        "Counting sorts for std::less and std::greater only\n");
+  }
+}
+
+template <typename Comparator, SortStability kStability>
+SortStatistics TapeSorter<Comparator, kStability>::Sort(
+    ITape& input_tape, ITape& output_tape) const {
+  SortStatistics statistics;
+  MultisetChecksum input_checksum;
+  auto modeled_start = temp_tape_creator_->GetModeledTime();
+  // The output is written through verification, progress, indexing and
+  // write-behind, in this order
+  auto* sorted_tape = &output_tape;
+  std::optional<WriteBehindTape> write_behind_tape;
+  if (options_.write_behind_buffer_size != 0) {
+    write_behind_tape.emplace(output_tape, options_.write_behind_buffer_size,
+                              options_.buffer_arena);
+    sorted_tape = &write_behind_tape.value();
+  }
+  std::optional<IndexingTape> indexing_tape;
+  if (options_.sparse_index) {
+    options_.sparse_index->Clear();
+    indexing_tape.emplace(*sorted_tape, *options_.sparse_index);
+    sorted_tape = &indexing_tape.value();
+  }
+  std::optional<ProgressTape> progress_tape;
+  if (options_.progress) {
+    progress_tape.emplace(*sorted_tape, *options_.progress);
+    sorted_tape = &progress_tape.value();
+  }
+  std::optional<VerifyingTape<Comparator>> verifying_output_tape;
+  if (options_.verify) {
+    verifying_output_tape.emplace(*sorted_tape, comparator_);
+    sorted_tape = &verifying_output_tape.value();
+  }
+
+  // The values from the head of the input are no more than all of them, and
+  // in order if all of them are
+  auto metadata = input_tape.GetMetadata();
+  if (metadata && IsInOrder(*metadata)) {
+    CopyValues(input_tape, *sorted_tape, input_checksum, statistics);
+  } else if (metadata && metadata->values_number <= GetBlockSize(0)) {
+    SortInMemory(input_tape, *sorted_tape, metadata->values_number,
+                 input_checksum, statistics);
+  } else if (options_.engine == SortEngine::kDistribution) {
+    statistics.engine = SortEngine::kDistribution;
+    std::optional<uint64_t> values_number;
+    if (metadata) {
+      values_number = metadata->values_number;
+    }
+    SortByDistribution(input_tape, *sorted_tape, values_number,
+                       &input_checksum, 0, statistics);
+  } else if (auto counting_plan = PlanCounting(
+                 metadata, input_tape.GetPosition().has_value())) {
+    statistics.engine = SortEngine::kCounting;
+    SortByCounting(input_tape, *sorted_tape, *counting_plan,
+                   GetComparatorOrder() == SortOrder::kDescending,
+                   input_checksum, statistics);
+  } else {
+    SortWithRuns(input_tape, *sorted_tape, &input_checksum, 0, statistics);
+  }
+  if (write_behind_tape) {
+    // Rethrows an error of the writer
+    write_behind_tape->Flush();
+  }
+  statistics.modeled_time =
+      temp_tape_creator_->GetModeledTime() - modeled_start;
+  if (verifying_output_tape &&
+      verifying_output_tape->GetChecksum() != input_checksum) {
+    throw SortVerificationError(
+        "Output is not a permutation of the input\n");
+  }
+  return statistics;
+}
+
+template <typename Comparator, SortStability kStability>
+constexpr SortOrder TapeSorter<Comparator, kStability>::GetComparatorOrder() {
+  if constexpr (std::is_same_v<Comparator, std::less<int>> ||
+                std::is_same_v<Comparator, std::less<>>) {
+    return SortOrder::kAscending;
+  } else if constexpr (std::is_same_v<Comparator, std::greater<int>> ||
+                       std::is_same_v<Comparator, std::greater<>>) {
+    return SortOrder::kDescending;
+  } else {
+    return SortOrder::kNone;
+  }
+}
+
+template <typename Comparator, SortStability kStability>
+bool TapeSorter<Comparator, kStability>::IsInOrder(
+    const TapeMetadata& metadata) {
+  if (metadata.values_number < 2 || metadata.min == metadata.max) {
+    return true;
+  }
+  // The order of other comparators is unknown
+  constexpr auto order = GetComparatorOrder();
+  return order != SortOrder::kNone && metadata.sort_order == order;
+}
+
+template <typename Comparator, SortStability kStability>
+void TapeSorter<Comparator, kStability>::SortInMemory(
+    ITape& input_tape, ITape& output_tape, size_t values_number,
+    MultisetChecksum& input_checksum, SortStatistics& statistics) const {
+  auto start = Clock::now();
+  auto buffer = options_.buffer_arena->Acquire(
+      std::max<size_t>(values_number, 1) * sizeof(int));
+  auto* block = buffer.Data<int>();
+  auto size = ReadBlock(input_tape, block, values_number);
+  statistics.values_number = size;
+  statistics.runs_number = 1;
+  statistics.schedule.push_back({SortStepKind::kRun, 1, size});
+  CountInputValues(block, size, input_checksum);
+  SortBlock(block, size);
+  auto write_start = Clock::now();
+  statistics.run_generation_time = write_start - start;
+  WriteBlock(output_tape, block, size);
+  statistics.merge_time = Clock::now() - write_start;
+}
+
+template <typename Comparator, SortStability kStability>
+void TapeSorter<Comparator, kStability>::SortWithRuns(
+    ITape& input_tape, ITape& output_tape, MultisetChecksum* input_checksum,
+    size_t open_tapes_number, SortStatistics& statistics) const {
+  auto start = Clock::now();
+  auto runs = SplitIntoSortedSubTapes(input_tape, input_checksum,
+                                      open_tapes_number, statistics);
+  auto merge_start = Clock::now();
+  statistics.run_generation_time = merge_start - start;
+
+  // An output tape which takes no drive leaves the drive of a merged run to
+  // the final merge
+  auto final_merge_ways = max_merge_ways_;
+  if (final_merge_ways != std::numeric_limits<size_t>::max() &&
+      !temp_tape_creator_->TakesDrive(output_tape)) {
+    ++final_merge_ways;
+  }
+  while (GetDriveRunsNumber(runs) > final_merge_ways) {
+    MergeShortestRuns(runs, statistics);
+  }
+  auto sources = GetSources(runs, 0, runs.size());
+  statistics.schedule.push_back(
+      {SortStepKind::kFinalMerge, runs.size(), statistics.values_number});
+  MergeSources<Comparator, kStability>(sources, output_tape, {},
+                                       temp_tape_creator_.get(), comparator_);
+  statistics.merge_time = Clock::now() - merge_start;
+}
+
+template <typename Comparator, SortStability kStability>
+void TapeSorter<Comparator, kStability>::SortByDistribution(
+    ITape& input_tape, ITape& output_tape,
+    std::optional<uint64_t> values_number, MultisetChecksum* input_checksum,
+    size_t open_tapes_number, SortStatistics& statistics) const {
+  auto start = Clock::now();
+  auto buckets_number = GetBucketsNumber(values_number, open_tapes_number);
+  // Sizes both the sample and the buckets sorted in memory, the bucket tapes
+  // are open meanwhile
+  auto block_size = GetBlockSize(open_tapes_number + buckets_number);
+  auto buffer = options_.buffer_arena->Acquire(block_size * sizeof(int));
+  auto* block = buffer.Data<int>();
+  auto size = ReadBlock(input_tape, block, block_size);
+  statistics.values_number = size;
+  if (input_checksum) {
+    CountInputValues(block, size, *input_checksum);
+  }
+  if (size != block_size) {
+    // The input fits a block
+    statistics.runs_number = 1;
+    statistics.schedule.push_back({SortStepKind::kRun, 1, size});
+    SortBlock(block, size);
+    auto write_start = Clock::now();
+    statistics.run_generation_time = write_start - start;
+    WriteBlock(output_tape, block, size);
+    statistics.merge_time = Clock::now() - write_start;
+    return;
+  }
+
+  auto splitters = ChooseSplitters(block, size, buckets_number);
+  std::vector<std::unique_ptr<ITape>> buckets;
+  std::vector<size_t> bucket_sizes(splitters.size() + 1);
+  for (size_t i = 0; i != bucket_sizes.size(); ++i) {
+    buckets.push_back(temp_tape_creator_->Create());
+  }
+  auto scatter = [&](int value) {
+    // Equivalent values go to the same bucket in the order of the input, so
+    // the distribution is stable
+    auto bucket = std::upper_bound(splitters.begin(), splitters.end(), value,
+                                   comparator_) -
+                  splitters.begin();
+    buckets[bucket]->WriteForward(value);
+    ++bucket_sizes[bucket];
+  };
+  for (size_t i = 0; i != size; ++i) {
+    scatter(block[i]);
+  }
+  // The rest of the input is counted by blocks as well
+  while ((size = ReadBlock(input_tape, block, block_size)) != 0) {
+    statistics.values_number += size;
+    if (input_checksum) {
+      CountInputValues(block, size, *input_checksum);
+    }
+    for (size_t i = 0; i != size; ++i) {
+      scatter(block[i]);
+    }
+  }
+  statistics.schedule.push_back(
+      {SortStepKind::kScatter, buckets.size(), statistics.values_number});
+  auto merge_start = Clock::now();
+  statistics.run_generation_time = merge_start - start;
+
+  for (size_t i = 0; i != buckets.size(); ++i) {
+    auto& bucket = *buckets[i];
+    bucket.Rewind();
+    if (bucket_sizes[i] <= block_size) {
+      if (!block) {
+        buffer = options_.buffer_arena->Acquire(block_size * sizeof(int));
+        block = buffer.Data<int>();
+      }
+      auto bucket_size = ReadBlock(bucket, block, bucket_sizes[i]);
+      ++statistics.runs_number;
+      statistics.schedule.push_back({SortStepKind::kRun, 1, bucket_size});
+      SortBlock(block, bucket_size);
+      WriteBlock(output_tape, block, bucket_size);
+    } else {
+      // Too many values of the input fell between two splitters. The bucket
+      // takes the memory of the block, and the buckets left are open.
+      buffer.Release();
+      block = nullptr;
+      auto bucket_open_tapes_number = open_tapes_number + buckets.size() - i;
+      SortStatistics bucket_statistics;
+      if (input_checksum) {
+        SortByDistribution(bucket, output_tape, bucket_sizes[i], nullptr,
+                           bucket_open_tapes_number, bucket_statistics);
+      } else {
+        SortWithRuns(bucket, output_tape, nullptr, bucket_open_tapes_number,
+                     bucket_statistics);
+      }
+      statistics.runs_number += bucket_statistics.runs_number;
+      statistics.early_merges_number += bucket_statistics.early_merges_number;
+      statistics.schedule.insert(statistics.schedule.end(),
+                                 bucket_statistics.schedule.begin(),
+                                 bucket_statistics.schedule.end());
+    }
+    buckets[i].reset();
+  }
+  statistics.merge_time = Clock::now() - merge_start;
+}
+
+template <typename Comparator, SortStability kStability>
+std::vector<int> TapeSorter<Comparator, kStability>::ChooseSplitters(
+    const int* block, size_t size, size_t buckets_number) const {
+  constexpr size_t kSamplesPerBucket = 32;
+  auto samples_number = std::min(size, buckets_number * kSamplesPerBucket);
+  std::vector<int> samples;
+  samples.reserve(samples_number);
+  for (size_t i = 0; i != samples_number; ++i) {
+    samples.push_back(block[i * size / samples_number]);
+  }
+  std::sort(samples.begin(), samples.end(), comparator_);
+  std::vector<int> splitters;
+  for (size_t i = 1; i != buckets_number; ++i) {
+    auto splitter = samples[i * samples_number / buckets_number];
+    if (splitters.empty() || comparator_(splitters.back(), splitter)) {
+      splitters.push_back(splitter);
+    }
+  }
+  return splitters;
+}
+
+template <typename Comparator, SortStability kStability>
+auto TapeSorter<Comparator, kStability>::SplitIntoSortedSubTapes(
+    ITape& input_tape, MultisetChecksum* input_checksum,
+    size_t open_tapes_number, SortStatistics& statistics) const
+    -> std::vector<Run> {
+  // The open tapes are left out, two runs at least are merged early
+  auto max_runs_number = max_runs_number_ > open_tapes_number + 2
+                             ? max_runs_number_ - open_tapes_number
+                             : 2;
+  std::vector<Run> runs;
+  auto is_exhausted = false;
+  while (!is_exhausted) {
+    while (runs.size() >= max_runs_number) {
+      MergeShortestRuns(runs, statistics);
+    }
+    auto block_size = GetBlockSize(open_tapes_number + runs.size());
+    // Given back to the arena before the next block or early merge
+    auto buffer = options_.buffer_arena->Acquire(block_size * sizeof(int));
+    auto* block = buffer.Data<int>();
+    auto size = ReadBlock(input_tape, block, block_size);
+    // A short block means the input is exhausted, so the end of the tape is
+    // probed exactly once
+    is_exhausted = size != block_size;
+    if (size == 0) {
+      break;
+    }
+    if (!is_exhausted && options_.keep_tail_run_in_memory) {
+      // A full block may be the last one, the current value is peeked
+      // without moving the head
+      is_exhausted = !input_tape.Read();
+    }
+    statistics.values_number += size;
+    ++statistics.runs_number;
+    statistics.schedule.push_back({SortStepKind::kRun, 1, size});
+    if (input_checksum) {
+      CountInputValues(block, size, *input_checksum);
+    }
+    SortBlock(block, size);
+    if (is_exhausted && options_.keep_tail_run_in_memory) {
+      // The merge reads the tail from the block, its memory is not needed by
+      // another block anymore
+      runs.push_back({CreateMemoryRun(std::move(buffer), size),
+                      RunLayout::kForward, 0, size});
+      break;
+    }
+    auto temp_tape = temp_tape_creator_->Create();
+    if (options_.run_layout == RunLayout::kForward) {
+      WriteBlock(*temp_tape, block, size);
+      // back to the first (min) element
+      temp_tape->Rewind();
+    } else {
+      // the block is in order, the run is written in reverse
+      WriteBlockReversed(*temp_tape, block, size);
+      // move to last (min) element
+      temp_tape->MoveBackward();
+    }
+    runs.push_back({std::move(temp_tape), options_.run_layout, 0, size});
+  }
+
+  return runs;
+}
+
+template <typename Comparator, SortStability kStability>
+void TapeSorter<Comparator, kStability>::SortBlock(int* block,
+                                                   size_t size) const {
+  auto threads_number = options_.threads_number;
+  if (threads_number == 1 || size < kMinParallelSortSize) {
+    if constexpr (kStability == SortStability::kStable) {
+      auto scratch_buffer = options_.buffer_arena->Acquire(size * sizeof(int));
+      SortRange(block, block + size, scratch_buffer.Data<int>());
+    } else {
+      SortRange(block, block + size, nullptr);
+    }
+    return;
+  }
+
+  // Parts are sorted in parallel, then merged pairwise into the scratch
+  // buffer and back, the pairs of a pass are merged in parallel as well. A
+  // merged part of a pass spans parts_width parts of the first one.
+  auto scratch_buffer = options_.buffer_arena->Acquire(size * sizeof(int));
+  auto* scratch = scratch_buffer.Data<int>();
+  auto bound = [size, threads_number](size_t part) {
+    return size * std::min(part, threads_number) / threads_number;
+  };
+  RunInParallel(threads_number, [&](size_t i) {
+    SortRange(block + bound(i), block + bound(i + 1), scratch + bound(i));
+  });
+
+  auto* source = block;
+  auto* destination = scratch;
+  for (size_t parts_width = 1; parts_width < threads_number;
+       parts_width *= 2) {
+    auto pairs_number =
+        (threads_number + 2 * parts_width - 1) / (2 * parts_width);
+    RunInParallel(pairs_number, [&](size_t pair) {
+      auto begin = bound(2 * pair * parts_width);
+      auto middle = bound((2 * pair + 1) * parts_width);
+      auto end = bound((2 * pair + 2) * parts_width);
+      // std::merge takes equivalent values from the first range first, so
+      // it is stable
+      std::merge(source + begin, source + middle, source + middle,
+                 source + end, destination + begin, comparator_);
+    });
+    std::swap(source, destination);
+  }
+  if (source != block) {
+    std::copy(source, source + size, block);
+  }
+}
+
+template <typename Comparator, SortStability kStability>
+void TapeSorter<Comparator, kStability>::SortRange(int* begin, int* end,
+                                                   int* scratch) const {
+  if constexpr (kStability == SortStability::kStable) {
+    // Bottom-up merge sort of insertion sorted slices, std::stable_sort
+    // would allocate its buffer on the heap
+    constexpr size_t kSliceSize = 32;
+    auto size = static_cast<size_t>(end - begin);
+    for (size_t first = 0; first < size; first += kSliceSize) {
+      auto last = std::min(first + kSliceSize, size);
+      for (auto i = first + 1; i < last; ++i) {
+        auto value = begin[i];
+        auto j = i;
+        for (; j != first && comparator_(value, begin[j - 1]); --j) {
+          begin[j] = begin[j - 1];
+        }
+        begin[j] = value;
+      }
+    }
+    auto* source = begin;
+    auto* destination = scratch;
+    for (auto width = kSliceSize; width < size; width *= 2) {
+      for (size_t first = 0; first < size; first += 2 * width) {
+        auto middle = std::min(first + width, size);
+        auto last = std::min(first + 2 * width, size);
+        std::merge(source + first, source + middle, source + middle,
+                   source + last, destination + first, comparator_);
+      }
+      std::swap(source, destination);
+    }
+    if (source != begin) {
+      std::copy(source, source + size, begin);
+    }
+  } else {
+    std::sort(begin, end, comparator_);
+  }
+}
+
+template <typename Comparator, SortStability kStability>
+void TapeSorter<Comparator, kStability>::MergeShortestRuns(
+    std::vector<Run>& runs, SortStatistics& statistics) const {
+  auto [first, runs_number] = GetShortestRuns(runs);
+  auto sources = GetSources(runs, first, runs_number);
+  std::vector<const ITape*> source_tapes;
+  for (const auto& source : sources) {
+    source_tapes.push_back(source.tape);
+  }
+  auto merged_tape = temp_tape_creator_->CreateForMerge(source_tapes);
+  MergeSources<Comparator, kStability>(sources, *merged_tape, {}, nullptr,
+                                       comparator_);
+  merged_tape->Rewind();
+  ReplaceRuns(runs, first, runs_number, std::move(merged_tape), statistics);
+}
+
 }  // namespace tape_sorter
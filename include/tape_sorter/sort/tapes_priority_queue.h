@@ -0,0 +1,133 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <queue>
+#include <vector>
+
+#include "tape_sorter/sort/run_layout.h"
+#include "tape_sorter/sort/sort_stability.h"
+#include "tape_sorter/tape_interface.h"
+
+namespace tape_sorter {
+
+// Sorted tape with its head on the minimal value
+struct MergeSource {
+  ITape* tape;
+  RunLayout layout;
+};
+
+// Heads of the sorted tapes ordered by Comparator, the minimal one on top.
+// With SortStability::kStable equivalent heads are ordered by their tapes.
+template <typename Comparator = std::less<int>,
+          SortStability kStability = SortStability::kUnstable>
+class TapesPriorityQueue {
+ public:
+  // The tapes are not owned and must outlive the queue
+  TapesPriorityQueue(const std::vector<MergeSource>& sources,
+                     Comparator comparator = {});
+
+  int Top();
+
+  void Pop();
+
+  bool Empty();
+
+ private:
+  struct QueueItem;
+
+  struct TapeComparator;
+
+ private:
+  static std::optional<int> ReadNext(const MergeSource& source);
+
+ private:
+  std::priority_queue<QueueItem, std::vector<QueueItem>, TapeComparator>
+      tapes_queue_;
+};
+
+// IMPLEMENTATION
+
+template <typename Comparator, SortStability kStability>
+struct TapesPriorityQueue<Comparator, kStability>::QueueItem {
+  QueueItem(const MergeSource& tape, int value, size_t tape_index)
+      : source{tape}, min_value{value}, index{tape_index} {}
+  MergeSource source;
+  int min_value;
+  // Position of the tape among the sources
+  size_t index;
+};
+
+template <typename Comparator, SortStability kStability>
+struct TapesPriorityQueue<Comparator, kStability>::TapeComparator {
+  // std::priority_queue keeps the greatest item on top
+  bool operator()(const QueueItem& lhs, const QueueItem& rhs) const {
+    if constexpr (kStability == SortStability::kStable) {
+      if (!comparator(lhs.min_value, rhs.min_value) &&
+          !comparator(rhs.min_value, lhs.min_value)) {
+        return lhs.index > rhs.index;
+      }
+    }
+    return comparator(rhs.min_value, lhs.min_value);
+  }
+
+  Comparator comparator;
+};
+
+template <typename Comparator, SortStability kStability>
+inline TapesPriorityQueue<Comparator, kStability>::TapesPriorityQueue(
+    const std::vector<MergeSource>& sources, Comparator comparator) {
+  std::vector<QueueItem> items;
+  items.reserve(sources.size());
+  for (size_t i = 0; i != sources.size(); ++i) {
+    if (auto min_value = ReadNext(sources[i])) {
+      items.emplace_back(sources[i], min_value.value(), i);
+    }
+  }
+  tapes_queue_ = decltype(tapes_queue_){
+      TapeComparator{std::move(comparator)}, std::move(items)};
+}
+
+template <typename Comparator, SortStability kStability>
+inline bool TapesPriorityQueue<Comparator, kStability>::Empty() {
+  return tapes_queue_.empty();
+}
+
+template <typename Comparator, SortStability kStability>
+inline int TapesPriorityQueue<Comparator, kStability>::Top() {
+  return tapes_queue_.top().min_value;
+}
+
+template <typename Comparator, SortStability kStability>
+inline void TapesPriorityQueue<Comparator, kStability>::Pop() {
+  auto min_value_tape = tapes_queue_.top();
+  tapes_queue_.pop();
+  auto new_tape_min_value = ReadNext(min_value_tape.source);
+  if (new_tape_min_value) {
+    min_value_tape.min_value = new_tape_min_value.value();
+    tapes_queue_.push(min_value_tape);
+  }
+}
+
+template <typename Comparator, SortStability kStability>
+inline std::optional<int> TapesPriorityQueue<Comparator, kStability>::ReadNext(
+    const MergeSource& source) {
+  return source.layout == RunLayout::kForward ? source.tape->ReadForward()
+                                              : source.tape->ReadBackward();
+}
+
+}  // namespace tape_sorter
@@ -15,7 +15,10 @@
 #pragma once
 
 #include <filesystem>
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "tape_sorter/file_tape.h"
 #include "tape_sorter/sort/temp_tape_creator_interface.h"
@@ -24,14 +27,69 @@ namespace tape_sorter {
 
 namespace fs = std::filesystem;
 
+struct TempDirectory {
+  TempDirectory(fs::path directory_path, double directory_weight = 1)
+      : path(std::move(directory_path)), weight(directory_weight) {}
+
+  fs::path path;
+  // Share of the tapes placed in the directory, relative to the others
+  double weight;
+};
+
+enum class TempPlacement {
+  // The directories take turns in proportion to their weights
+  kRoundRobin,
+  // Same, with the weights scaled by the free space of the directories
+  kFreeSpace,
+};
+
 class TempFileTapeCreator : public ITempTapeCreator {
  public:
-  TempFileTapeCreator(TapeDelayConfig config = {});
+  // Files of the tapes are spread over the directories, the system temporary
+  // directory is used when there are none. A file is removed with its tape.
+  // Throws std::invalid_argument for a weight that is not positive.
+  TempFileTapeCreator(TapeDelayConfig config = {},
+                      FileTapeBackend backend = FileTapeBackend::kStream,
+                      std::vector<TempDirectory> directories = {},
+                      TempPlacement placement = TempPlacement::kRoundRobin);
 
   std::unique_ptr<ITape> Create() override;
 
+  // Prefers a directory on another device than the source tapes, then
+  // another directory
+  std::unique_ptr<ITape> CreateForMerge(
+      const std::vector<const ITape*>& source_tapes) override;
+
+  size_t GetTapeMemoryUsage() const override;
+
+  void SetBufferArena(std::shared_ptr<BufferArena> buffer_arena) override;
+
+  // Delays paid by the created tapes
+  std::chrono::microseconds GetModeledTime() const override;
+
+  // Operations performed on all the created tapes
+  const TapeOperationCounts& GetOperationCounts() const;
+
+  size_t GetCreatedTapesNumber() const;
+
+ private:
+  // Smooth weighted round robin over the directories not excluded, or over
+  // all of them when every one is
+  size_t ChooseDirectory(const std::vector<bool>& is_excluded);
+
+  std::unique_ptr<ITape> CreateInDirectory(size_t directory);
+
  private:
   TapeDelayConfig config_;
+  FileTapeBackend backend_;
+  std::vector<TempDirectory> directories_;
+  TempPlacement placement_;
+  // Device of each directory
+  std::vector<uint64_t> devices_;
+  std::vector<double> current_weights_;
+  std::shared_ptr<TapeOperationCounts> operation_counts_;
+  std::shared_ptr<BufferArena> buffer_arena_;
+  size_t created_tapes_number_{0};
 };
 
 }  // namespace tape_sorter
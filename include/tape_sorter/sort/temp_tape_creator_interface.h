@@ -14,8 +14,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <memory>
+#include <vector>
 
+#include "tape_sorter/buffer_arena.h"
 #include "tape_sorter/tape_interface.h"
 
 namespace tape_sorter {
@@ -24,6 +28,33 @@ class ITempTapeCreator {
  public:
   virtual std::unique_ptr<ITape> Create() = 0;
 
+  // Creates a tape written while the source tapes, created by this creator,
+  // are read. Implementations may place it apart from them.
+  virtual std::unique_ptr<ITape> CreateForMerge(
+      const std::vector<const ITape*>& /*source_tapes*/) {
+    return Create();
+  }
+
+  // Upper bound of the memory in bytes a created tape keeps while it exists
+  virtual size_t GetTapeMemoryUsage() const { return 0; }
+
+  // Tapes created afterwards take their buffers from the arena, if they have
+  // any
+  virtual void SetBufferArena(std::shared_ptr<BufferArena> /*buffer_arena*/) {}
+
+  // Number of created tapes that can be used at once, 0 when unlimited
+  virtual size_t GetMaxMountedTapes() const { return 0; }
+
+  // Whether the tape is one of the created ones counted by
+  // GetMaxMountedTapes, not e.g. a run kept in memory or an output tape
+  virtual bool TakesDrive(const ITape& /*tape*/) const { return false; }
+
+  // Whether using the tape now takes no mount
+  virtual bool IsMounted(const ITape& /*tape*/) const { return true; }
+
+  // Time the created tapes have spent so far by the delay model
+  virtual std::chrono::microseconds GetModeledTime() const { return {}; }
+
   virtual ~ITempTapeCreator() = default;
 };
 
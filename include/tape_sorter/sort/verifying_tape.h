@@ -0,0 +1,84 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <sstream>
+#include <utility>
+
+#include "tape_sorter/sort/sort_verification.h"
+#include "tape_sorter/tape_interface.h"
+
+namespace tape_sorter {
+
+// Checks the order of the values written forward through it and sums them up
+template <typename Comparator = std::less<int>>
+class VerifyingTape : public ITape {
+ public:
+  VerifyingTape(ITape& tape, Comparator comparator = {})
+      : tape_(tape), comparator_(std::move(comparator)) {}
+
+  std::optional<int> Read() override { return tape_.Read(); }
+
+  void Write(int value) override {
+    tape_.Write(value);
+    pending_value_ = value;
+  }
+
+  bool MoveForward() override {
+    if (!tape_.MoveForward()) {
+      return false;
+    }
+    if (pending_value_) {
+      Check(pending_value_.value());
+      pending_value_.reset();
+    }
+    return true;
+  }
+
+  bool MoveBackward() override { return tape_.MoveBackward(); }
+
+  void Rewind() override { tape_.Rewind(); }
+
+  void WriteForward(int value) override {
+    Check(value);
+    pending_value_.reset();
+    tape_.WriteForward(value);
+  }
+
+  const MultisetChecksum& GetChecksum() const { return checksum_; }
+
+ private:
+  void Check(int value) {
+    if (checksum_.count != 0 && comparator_(value, last_value_)) {
+      std::stringstream msg_stream;
+      msg_stream << "Output is not sorted at position " << checksum_.count
+                 << ": " << value << " follows " << last_value_ << '\n';
+      throw SortVerificationError(msg_stream.str());
+    }
+    checksum_.Add(value);
+    last_value_ = value;
+  }
+
+ private:
+  ITape& tape_;
+  Comparator comparator_;
+  MultisetChecksum checksum_;
+  int last_value_{0};
+  std::optional<int> pending_value_;
+};
+
+}  // namespace tape_sorter
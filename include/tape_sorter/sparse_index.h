@@ -0,0 +1,178 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "tape_sorter/file_tape.h"
+#include "tape_sorter/tape_interface.h"
+
+namespace tape_sorter {
+
+namespace fs = std::filesystem;
+
+// Every stride-th value of a sorted tape with its position, so a search
+// seeks next to a value instead of stepping through the tape. Positions
+// count from the first value added.
+class SparseIndex {
+ public:
+  struct Entry {
+    int key;
+    uint64_t position;
+  };
+
+  static constexpr size_t kDefaultStride = 1024;
+
+  // Throws std::invalid_argument for a zero stride
+  explicit SparseIndex(size_t stride = kDefaultStride);
+
+  // Takes the next value of the tape, keeps it if it starts a stride
+  void Add(int value);
+
+  void Clear();
+
+  size_t GetStride() const;
+
+  // Values added
+  uint64_t GetValuesNumber() const;
+
+  const std::vector<Entry>& GetEntries() const;
+
+  // Sidecar file of a tape file
+  static fs::path GetSidecarPath(const fs::path& tape_path);
+
+  // Throws std::runtime_error when the file cannot be written
+  void Save(const fs::path& path) const;
+
+  // Throws std::runtime_error when the file is missing or is not an index
+  static SparseIndex Load(const fs::path& path);
+
+ private:
+  size_t stride_;
+  uint64_t values_number_{0};
+  std::vector<Entry> entries_;
+};
+
+// Adds the values written forward through it to a SparseIndex
+class IndexingTape : public ITape {
+ public:
+  // Neither is owned
+  IndexingTape(ITape& tape, SparseIndex& index);
+
+  std::optional<int> Read() override;
+
+  void Write(int value) override;
+
+  bool MoveForward() override;
+
+  bool MoveBackward() override;
+
+  void Rewind() override;
+
+  void WriteForward(int value) override;
+
+ private:
+  ITape& tape_;
+  SparseIndex& index_;
+};
+
+// Searches a file tape sorted in the order of Comparator through its index:
+// a search seeks to the last entry before the key and reads at most a stride
+// of values from there
+template <typename Comparator = std::less<int>>
+class IndexedTapeReader {
+ public:
+  // Neither is owned, the index must be the one of the tape
+  IndexedTapeReader(FileTape& tape, const SparseIndex& index,
+                    Comparator comparator = {});
+
+  // Moves the head to the first value not ordered before the key and returns
+  // its position, the number of values when there is none
+  uint64_t LowerBound(int key);
+
+  // Whether the tape holds a value equivalent to the key
+  bool Contains(int key);
+
+  // Calls visitor(value) for the values from first_key to last_key, both
+  // included, and returns their number
+  template <typename Visitor>
+  size_t ScanRange(int first_key, int last_key, Visitor visitor);
+
+ private:
+  FileTape& tape_;
+  const SparseIndex& index_;
+  Comparator comparator_;
+};
+
+// IMPLEMENTATION
+
+template <typename Comparator>
+IndexedTapeReader<Comparator>::IndexedTapeReader(FileTape& tape,
+                                                 const SparseIndex& index,
+                                                 Comparator comparator)
+    : tape_(tape), index_(index), comparator_(std::move(comparator)) {}
+
+template <typename Comparator>
+uint64_t IndexedTapeReader<Comparator>::LowerBound(int key) {
+  const auto& entries = index_.GetEntries();
+  // The first entry not before the key bounds the scan, equivalent values
+  // may precede it within the stride
+  auto bound = std::partition_point(
+      entries.begin(), entries.end(),
+      [this, key](const SparseIndex::Entry& entry) {
+        return comparator_(entry.key, key);
+      });
+  uint64_t position = bound == entries.begin() ? 0 : (bound - 1)->position;
+  tape_.Seek(position);
+  while (auto value = tape_.Read()) {
+    if (!comparator_(value.value(), key)) {
+      break;
+    }
+    tape_.MoveForward();
+    ++position;
+  }
+  return position;
+}
+
+template <typename Comparator>
+bool IndexedTapeReader<Comparator>::Contains(int key) {
+  LowerBound(key);
+  auto value = tape_.Read();
+  return value && !comparator_(key, value.value());
+}
+
+template <typename Comparator>
+template <typename Visitor>
+size_t IndexedTapeReader<Comparator>::ScanRange(int first_key, int last_key,
+                                                Visitor visitor) {
+  LowerBound(first_key);
+  size_t values_number = 0;
+  while (auto value = tape_.ReadForward()) {
+    if (comparator_(last_key, value.value())) {
+      break;
+    }
+    visitor(value.value());
+    ++values_number;
+  }
+  return values_number;
+}
+
+}  // namespace tape_sorter
@@ -0,0 +1,142 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "tape_sorter/buffer_arena.h"
+
+namespace tape_sorter {
+
+// Bounded lock-free queue for one producer thread and one consumer thread
+template <typename T>
+class SpscRingBuffer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "The values are kept in raw memory of the arena");
+
+ public:
+  // The capacity is rounded up to a power of two, the values are kept in a
+  // buffer of the arena
+  explicit SpscRingBuffer(
+      size_t capacity,
+      std::shared_ptr<BufferArena> arena = std::make_shared<BufferArena>());
+
+  // Producer side, returns false when the buffer is full
+  bool TryPush(const T& value);
+
+  // Producer side, whether the consumer has taken every value
+  bool Empty() const;
+
+  // Consumer side, pops up to max_values_number values into values and
+  // returns their number
+  size_t TryPop(T* values, size_t max_values_number);
+
+  size_t GetCapacity() const;
+
+  // Bytes of the values of a buffer of the capacity
+  static size_t GetMemoryUsage(size_t capacity);
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  static size_t RoundCapacity(size_t capacity);
+
+ private:
+  // Outlives the buffer taken from it
+  std::shared_ptr<BufferArena> arena_;
+  BufferArena::Buffer buffer_;
+  T* values_;
+  size_t mask_;
+  // Next value to pop, written by the consumer
+  alignas(kCacheLineSize) std::atomic<size_t> head_{0};
+  // Last tail seen by the consumer
+  size_t cached_tail_{0};
+  // Next value to push, written by the producer
+  alignas(kCacheLineSize) std::atomic<size_t> tail_{0};
+  // Last head seen by the producer
+  size_t cached_head_{0};
+};
+
+// IMPLEMENTATION
+
+template <typename T>
+SpscRingBuffer<T>::SpscRingBuffer(size_t capacity,
+                                  std::shared_ptr<BufferArena> arena)
+    : arena_(std::move(arena)),
+      buffer_(arena_->Acquire(GetMemoryUsage(capacity))),
+      values_(buffer_.Data<T>()),
+      mask_(RoundCapacity(capacity) - 1) {}
+
+template <typename T>
+inline bool SpscRingBuffer<T>::TryPush(const T& value) {
+  auto tail = tail_.load(std::memory_order_relaxed);
+  if (tail - cached_head_ == mask_ + 1) {
+    cached_head_ = head_.load(std::memory_order_acquire);
+    if (tail - cached_head_ == mask_ + 1) {
+      return false;
+    }
+  }
+  values_[tail & mask_] = value;
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+inline bool SpscRingBuffer<T>::Empty() const {
+  return head_.load(std::memory_order_acquire) ==
+         tail_.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+inline size_t SpscRingBuffer<T>::TryPop(T* values, size_t max_values_number) {
+  auto head = head_.load(std::memory_order_relaxed);
+  if (cached_tail_ == head) {
+    cached_tail_ = tail_.load(std::memory_order_acquire);
+    if (cached_tail_ == head) {
+      return 0;
+    }
+  }
+  auto values_number = std::min(cached_tail_ - head, max_values_number);
+  for (size_t i = 0; i != values_number; ++i) {
+    values[i] = values_[(head + i) & mask_];
+  }
+  head_.store(head + values_number, std::memory_order_release);
+  return values_number;
+}
+
+template <typename T>
+size_t SpscRingBuffer<T>::GetCapacity() const {
+  return mask_ + 1;
+}
+
+template <typename T>
+size_t SpscRingBuffer<T>::GetMemoryUsage(size_t capacity) {
+  return RoundCapacity(capacity) * sizeof(T);
+}
+
+template <typename T>
+size_t SpscRingBuffer<T>::RoundCapacity(size_t capacity) {
+  size_t rounded_capacity = 1;
+  while (rounded_capacity < capacity) {
+    rounded_capacity *= 2;
+  }
+  return rounded_capacity;
+}
+
+}  // namespace tape_sorter
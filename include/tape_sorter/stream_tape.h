@@ -0,0 +1,141 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "tape_sorter/tape_interface.h"
+
+namespace tape_sorter {
+
+namespace fs = std::filesystem;
+
+enum class StreamFormat {
+  // Native int representation, as in FileTape
+  kBinary,
+  // Decimal integers separated by whitespace, written one per line
+  kText,
+};
+
+// Forward-only tape reading a non-seekable source (stdin, pipe, socket or
+// file) through a large buffer. Moving backward and rewinding are not
+// supported.
+class InputStreamTape : public ITape {
+ public:
+  static constexpr size_t kDefaultBufferSize = 1 << 20;
+
+  // The descriptor is not closed by the tape
+  explicit InputStreamTape(int fd, StreamFormat format = StreamFormat::kBinary,
+                           size_t buffer_size = kDefaultBufferSize);
+
+  explicit InputStreamTape(const fs::path& file_path,
+                           StreamFormat format = StreamFormat::kBinary,
+                           size_t buffer_size = kDefaultBufferSize);
+
+  InputStreamTape(const InputStreamTape&) = delete;
+
+  InputStreamTape& operator=(const InputStreamTape&) = delete;
+
+  ~InputStreamTape() override;
+
+  std::optional<int> Read() override;
+
+  void Write(int value) override;
+
+  bool MoveForward() override;
+
+  bool MoveBackward() override;
+
+  void Rewind() override;
+
+  std::optional<int> ReadForward() override;
+
+ private:
+  // Parses the current value if it has not been parsed yet
+  std::optional<int> Peek();
+
+  std::optional<int> ParseBinary();
+
+  std::optional<int> ParseText();
+
+  // Reads more data after the unparsed bytes, returns false at the end of
+  // the stream
+  bool Refill();
+
+ private:
+  int fd_;
+  bool owns_fd_;
+  StreamFormat format_;
+  std::vector<char> buffer_;
+  // unparsed bytes are [begin_, end_)
+  size_t begin_{0};
+  size_t end_{0};
+  bool is_eof_{false};
+  std::optional<int> current_value_;
+};
+
+// Forward-only tape appending to a non-seekable sink (stdout, pipe, socket
+// or file) through a large buffer. Values written and not moved past are not
+// emitted, reading, moving backward and rewinding are not supported.
+class OutputStreamTape : public ITape {
+ public:
+  static constexpr size_t kDefaultBufferSize = 1 << 20;
+
+  // The descriptor is not closed by the tape
+  explicit OutputStreamTape(int fd,
+                            StreamFormat format = StreamFormat::kBinary,
+                            size_t buffer_size = kDefaultBufferSize);
+
+  // The file is truncated
+  explicit OutputStreamTape(const fs::path& file_path,
+                            StreamFormat format = StreamFormat::kBinary,
+                            size_t buffer_size = kDefaultBufferSize);
+
+  OutputStreamTape(const OutputStreamTape&) = delete;
+
+  OutputStreamTape& operator=(const OutputStreamTape&) = delete;
+
+  // Flushes the buffer ignoring errors, call Flush to observe them
+  ~OutputStreamTape() override;
+
+  std::optional<int> Read() override;
+
+  void Write(int value) override;
+
+  bool MoveForward() override;
+
+  bool MoveBackward() override;
+
+  void Rewind() override;
+
+  void WriteForward(int value) override;
+
+  void Flush();
+
+ private:
+  void Append(int value);
+
+ private:
+  int fd_;
+  bool owns_fd_;
+  StreamFormat format_;
+  std::vector<char> buffer_;
+  size_t size_{0};
+  std::optional<int> pending_value_;
+};
+
+}  // namespace tape_sorter
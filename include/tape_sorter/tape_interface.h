@@ -14,7 +14,11 @@
 
 #pragma once
 
+#include <cstdint>
 #include <optional>
+#include <stdexcept>
+
+#include "tape_sorter/tape_metadata.h"
 
 namespace tape_sorter {
 
@@ -30,6 +34,47 @@ class ITape {
 
   virtual void Rewind() = 0;
 
+  // Fused cursor operations. The defaults are composed of the primitives
+  // above, implementations may override them to save physical operations.
+
+  // Reads the current value and moves forward if there was one
+  virtual std::optional<int> ReadForward() {
+    auto value = Read();
+    if (value) {
+      MoveForward();
+    }
+    return value;
+  }
+
+  // Reads the current value and moves backward if there was one
+  virtual std::optional<int> ReadBackward() {
+    auto value = Read();
+    if (value) {
+      MoveBackward();
+    }
+    return value;
+  }
+
+  // Writes the value and moves forward past it
+  virtual void WriteForward(int value) {
+    Write(value);
+    MoveForward();
+  }
+
+  // Index of the value under the head, nullopt when the tape cannot come
+  // back to it with Seek
+  virtual std::optional<uint64_t> GetPosition() const { return std::nullopt; }
+
+  // Moves the head to a position returned by GetPosition in one locate
+  virtual void Seek(uint64_t /*position*/) {
+    throw std::logic_error("Seeking a tape without positions\n");
+  }
+
+  // Metadata stored with the values, nullopt when it is unknown
+  virtual std::optional<TapeMetadata> GetMetadata() const {
+    return std::nullopt;
+  }
+
   virtual ~ITape() = default;
 };
 
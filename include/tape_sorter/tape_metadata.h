@@ -0,0 +1,39 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+namespace tape_sorter {
+
+enum class SortOrder : uint8_t {
+  kNone,
+  // Non-decreasing
+  kAscending,
+  // Non-increasing
+  kDescending,
+};
+
+// What is known of the values of a tape without reading them
+struct TapeMetadata {
+  uint64_t values_number{0};
+  // Meaningful for a non-empty tape
+  int min{0};
+  int max{0};
+  // kNone when the values are in neither order
+  SortOrder sort_order{SortOrder::kNone};
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,46 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace tape_sorter {
+
+// Number of physical operations performed on a tape, i.e. the number of
+// delays it has paid
+struct TapeOperationCounts {
+  size_t reads{0};
+  size_t writes{0};
+  size_t moves{0};
+  // subset of moves
+  size_t backward_moves{0};
+  size_t rewinds{0};
+  size_t seeks{0};
+  std::chrono::microseconds total_delay{0};
+
+  TapeOperationCounts& operator+=(const TapeOperationCounts& other) {
+    reads += other.reads;
+    writes += other.writes;
+    moves += other.moves;
+    backward_moves += other.backward_moves;
+    rewinds += other.rewinds;
+    seeks += other.seeks;
+    total_delay += other.total_delay;
+    return *this;
+  }
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,85 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tape_sorter {
+
+// Fixed set of threads running submitted tasks. Every thread has its own
+// queue under its own lock: tasks submitted from a thread of the pool go to
+// its queue and are taken from its back, idle threads steal from the fronts
+// of the others and sleep only when every queue is empty. Thread safe.
+class ThreadPool {
+ public:
+  // Throws std::invalid_argument without threads
+  explicit ThreadPool(size_t threads_number);
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Runs the tasks left, then joins the threads
+  ~ThreadPool();
+
+  // The task must not throw
+  void Submit(std::function<void()> task);
+
+  // Calls task(i) for every i below tasks_number and waits for them. The
+  // calling thread takes part, so it may be a thread of the pool, and the
+  // other threads join it when idle. Rethrows the first exception of the
+  // calls.
+  void ParallelFor(size_t tasks_number,
+                   const std::function<void(size_t)>& task);
+
+  size_t GetThreadsNumber() const;
+
+ private:
+  void WorkerLoop(size_t index);
+
+  // Waits for a task, false once the pool stops and the queues are empty
+  bool TakeTask(size_t index, std::function<void()>& task);
+
+  // From the back of the own queue, or from the front of another one
+  bool TryTakeTask(size_t index, std::function<void()>& task);
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+ private:
+  std::vector<Queue> queues_;
+  // Counted before a task is queued and after it is taken, so a thread does
+  // not sleep while a task is queued
+  std::atomic<size_t> queued_tasks_number_{0};
+  std::atomic<size_t> next_queue_{0};
+  // Submit takes the sleep lock only when a thread may be sleeping
+  std::atomic<size_t> sleeping_threads_number_{0};
+  bool is_stopping_{false};
+  std::mutex sleep_mutex_;
+  std::condition_variable task_queued_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,94 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#include "tape_sorter/spsc_ring_buffer.h"
+#include "tape_sorter/tape_interface.h"
+
+namespace tape_sorter {
+
+// Hands the values written forward through it to a writer thread, which
+// writes them to the wrapped tape in batches, so the caller does not wait
+// for the write delays. The values are buffered in a bounded ring, a full
+// ring makes the caller wait. Every other operation waits for the pending
+// values first. An error of the writer is rethrown by the next operation.
+class WriteBehindTape : public ITape {
+ public:
+  // The tape is not owned and must not be used until the values are flushed.
+  // The ring is taken from the arena.
+  WriteBehindTape(
+      ITape& tape, size_t buffer_size,
+      std::shared_ptr<BufferArena> arena = std::make_shared<BufferArena>());
+
+  WriteBehindTape(const WriteBehindTape&) = delete;
+
+  WriteBehindTape& operator=(const WriteBehindTape&) = delete;
+
+  // Waits for the pending values, an error of the writer is dropped
+  ~WriteBehindTape() override;
+
+  std::optional<int> Read() override;
+
+  void Write(int value) override;
+
+  bool MoveForward() override;
+
+  bool MoveBackward() override;
+
+  void Rewind() override;
+
+  std::optional<int> ReadForward() override;
+
+  std::optional<int> ReadBackward() override;
+
+  void WriteForward(int value) override;
+
+  // Waits until the pending values are written to the wrapped tape, rethrows
+  // an error of the writer
+  void Flush();
+
+  // Bytes of the ring of a tape buffering buffer_size values
+  static size_t GetMemoryUsage(size_t buffer_size);
+
+ private:
+  void WriterLoop();
+
+  void RethrowError() const;
+
+  // Yields the first rounds of a wait, then sleeps
+  static void Wait(size_t& idle_rounds);
+
+ private:
+  static constexpr size_t kBatchSize = 1024;
+
+ private:
+  ITape& tape_;
+  SpscRingBuffer<int> buffer_;
+  size_t pushed_values_number_{0};
+  std::atomic<size_t> written_values_number_{0};
+  std::atomic<bool> is_stopping_{false};
+  std::atomic<bool> has_failed_{false};
+  // Set before has_failed_
+  std::exception_ptr error_;
+  std::thread writer_;
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,165 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_sorter/buffer_arena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace tape_sorter {
+
+namespace {
+
+constexpr size_t kHugePageSize = 2 << 20;
+
+}  // namespace
+
+BufferArena::Buffer::Buffer(BufferArena* arena, char* data, size_t size,
+                            size_t capacity)
+    : arena_(arena), data_(data), size_(size), capacity_(capacity) {}
+
+BufferArena::Buffer::Buffer(Buffer&& other) noexcept
+    : arena_(std::exchange(other.arena_, nullptr)),
+      data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      capacity_(std::exchange(other.capacity_, 0)) {}
+
+BufferArena::Buffer& BufferArena::Buffer::operator=(Buffer&& other) noexcept {
+  if (this != &other) {
+    Release();
+    arena_ = std::exchange(other.arena_, nullptr);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    capacity_ = std::exchange(other.capacity_, 0);
+  }
+  return *this;
+}
+
+BufferArena::Buffer::~Buffer() { Release(); }
+
+void BufferArena::Buffer::Release() {
+  if (arena_ != nullptr) {
+    arena_->Release(data_, capacity_);
+  }
+  arena_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+  capacity_ = 0;
+}
+
+BufferArena::BufferArena(bool huge_pages)
+    : huge_pages_(huge_pages),
+      page_size_(static_cast<size_t>(::sysconf(_SC_PAGESIZE))) {}
+
+BufferArena::~BufferArena() { Trim(); }
+
+BufferArena::Buffer BufferArena::Acquire(size_t size) {
+  if (size == 0) {
+    return {};
+  }
+  auto capacity = RoundUp(size);
+  std::lock_guard lock{mutex_};
+
+  // The smallest free buffer that is not twice as large as needed
+  auto best = free_slots_.end();
+  for (auto it = free_slots_.begin(); it != free_slots_.end(); ++it) {
+    if (it->capacity >= capacity && it->capacity <= 2 * capacity &&
+        (best == free_slots_.end() || it->capacity < best->capacity)) {
+      best = it;
+    }
+  }
+  if (best != free_slots_.end()) {
+    auto slot = *best;
+    *best = free_slots_.back();
+    free_slots_.pop_back();
+    if (slot.capacity > capacity) {
+      // Pages past the requested size are given back until they are touched
+      // again, so a shrinking buffer does not keep its peak memory
+      ::madvise(slot.data + capacity, slot.capacity - capacity,
+                MADV_DONTNEED);
+    }
+    return {this, slot.data, size, slot.capacity};
+  }
+
+  free_slots_.reserve(mapped_buffers_ + 1);
+  auto* data = Map(capacity);
+  if (huge_pages_) {
+    // Only a hint, the kernel may not support transparent huge pages
+    ::madvise(data, capacity, MADV_HUGEPAGE);
+  }
+  ++mapped_buffers_;
+  ++maps_number_;
+  mapped_bytes_ += capacity;
+  return {this, static_cast<char*>(data), size, capacity};
+}
+
+void BufferArena::Trim() {
+  std::lock_guard lock{mutex_};
+  for (const auto& slot : free_slots_) {
+    ::munmap(slot.data, slot.capacity);
+    --mapped_buffers_;
+    mapped_bytes_ -= slot.capacity;
+  }
+  free_slots_.clear();
+}
+
+size_t BufferArena::GetMappedBytes() const {
+  std::lock_guard lock{mutex_};
+  return mapped_bytes_;
+}
+
+size_t BufferArena::GetMapsNumber() const {
+  std::lock_guard lock{mutex_};
+  return maps_number_;
+}
+
+void BufferArena::Release(char* data, size_t capacity) {
+  std::lock_guard lock{mutex_};
+  free_slots_.push_back({data, capacity});
+}
+
+char* BufferArena::Map(size_t capacity) const {
+  // Huge pages back only the aligned 2 MiB ranges of a mapping, so it is
+  // mapped larger and trimmed to an aligned one
+  auto alignment = huge_pages_ ? kHugePageSize : page_size_;
+  auto mapped_size = capacity + alignment - page_size_;
+  auto* data = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  auto* mapped = static_cast<char*>(data);
+  auto address = reinterpret_cast<uintptr_t>(mapped);
+  auto* aligned = mapped + (alignment - address % alignment) % alignment;
+  if (aligned != mapped) {
+    ::munmap(mapped, aligned - mapped);
+  }
+  auto tail_size = mapped + mapped_size - (aligned + capacity);
+  if (tail_size != 0) {
+    ::munmap(aligned + capacity, tail_size);
+  }
+  return aligned;
+}
+
+size_t BufferArena::RoundUp(size_t size) const {
+  auto granularity = huge_pages_ ? kHugePageSize : page_size_;
+  return (size + granularity - 1) / granularity * granularity;
+}
+
+}  // namespace tape_sorter
@@ -68,27 +68,48 @@ TapeDelayConfig TapeDelayConfigParser::Parse(const fs::path& config_path) {
   std::ifstream file(config_path);
   TapeDelayConfig config;
   if (file.is_open()) {
-    std::unordered_map<std::string, std::chrono::milliseconds> data;
+    std::unordered_map<std::string, std::string> data;
     std::string line;
 
     while (std::getline(file, line)) {
       auto [key, str_value] = ParseKeyValuePair(line);
-      int64_t value;
-      try {
-        value = std::stoll(str_value);
-      } catch (const std::ios::ios_base::failure&) {
+      // Every value is a number, std::invalid_argument is thrown otherwise
+      std::stod(str_value);
+      data[key] = str_value;
+    }
+
+    auto get_delay = [&data](const std::string& key) {
+      return std::chrono::milliseconds(std::stoll(data.at(key)));
+    };
+    auto get_model_delay = [&data](const std::string& key) {
+      auto it = data.find(key);
+      return std::chrono::microseconds(
+          it == data.end() ? 0 : std::stoll(it->second));
+    };
+    config.move_delay = get_delay(kMoveDelayKey);
+    config.read_delay = get_delay(kReadDelayKey);
+    config.write_delay = get_delay(kWriteDelayKey);
+    config.rewind_delay = get_delay(kRewindDelayKey);
+    if (data.count(kMoveBackwardDelayKey) != 0) {
+      config.move_backward_delay = get_delay(kMoveBackwardDelayKey);
+    }
+
+    auto& model = config.latency_model;
+    model.start_stop_delay = get_model_delay(kStartStopDelayKey);
+    model.streaming_delay = get_model_delay(kStreamingDelayKey);
+    model.repositioning_delay = get_model_delay(kRepositioningDelayKey);
+    model.rewind_delay_per_value = get_model_delay(kRewindDelayPerValueKey);
+    if (auto it = data.find(kJitterKey); it != data.end()) {
+      config.jitter = std::stod(it->second);
+      if (config.jitter < 0 || config.jitter > 1) {
         std::stringstream msg_stream;
-        msg_stream << "Cannot convert string to long long: '" << str_value
-                   << "'\n";
-        throw std::ifstream::failure(msg_stream.str());
+        msg_stream << "Jitter must be within [0, 1]: " << it->second << '\n';
+        throw std::invalid_argument{msg_stream.str()};
       }
-      data[key] = std::chrono::milliseconds(value);
     }
-
-    config.move_delay = data.at(kMoveDelayKey);
-    config.read_delay = data.at(kReadDelayKey);
-    config.write_delay = data.at(kWriteDelayKey);
-    config.rewind_delay = data.at(kRewindDelayKey);
+    if (auto it = data.find(kSeedKey); it != data.end()) {
+      config.seed = std::stoull(it->second);
+    }
   } else {
     std::stringstream msg_stream;
     msg_stream << "Failed to open file: " << config_path << '\n';
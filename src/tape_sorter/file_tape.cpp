@@ -14,78 +14,236 @@
 
 #include "tape_sorter/file_tape.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "storage/direct_file_storage.h"
+#include "storage/framed_file_storage.h"
+#include "storage/stream_file_storage.h"
+
 namespace tape_sorter {
 
 namespace fs = std::filesystem;
 
-FileTape::FileTape(const fs::path& file_path, TapeDelayConfig config)
-    : delay_config_(std::move(config)) {
-  if (!std::filesystem::exists(file_path)) {
-    std::ofstream{file_path};
+namespace {
+
+std::unique_ptr<IFileTapeStorage> CreateStorage(
+    const fs::path& file_path, FileTapeBackend backend,
+    std::shared_ptr<BufferArena> buffer_arena, FileTapeFormat format) {
+  std::unique_ptr<IFileTapeStorage> storage;
+  if (backend == FileTapeBackend::kDirect) {
+    if (!buffer_arena) {
+      buffer_arena = std::make_shared<BufferArena>();
+    }
+    storage = std::make_unique<DirectFileStorage>(file_path,
+                                                  std::move(buffer_arena));
+  } else {
+    storage = std::make_unique<StreamFileStorage>(file_path);
   }
-  tape_stream_ = std::fstream{
-      file_path, std::fstream::in | std::fstream::out | std::fstream::binary};
+  return FramedFileStorage::Open(std::move(storage), format);
 }
 
+}  // namespace
+
+FileTape::FileTape(const fs::path& file_path, TapeDelayConfig config,
+                   FileTapeBackend backend,
+                   std::shared_ptr<TapeOperationCounts> operation_counts,
+                   std::shared_ptr<BufferArena> buffer_arena,
+                   FileTapeFormat format)
+    : storage_(CreateStorage(file_path, backend, std::move(buffer_arena),
+                             format)),
+      framed_storage_(dynamic_cast<FramedFileStorage*>(storage_.get())),
+      delay_config_(std::move(config)),
+      random_generator_(delay_config_.seed),
+      operation_counts_(std::move(operation_counts)) {}
+
+FileTape::FileTape(FileTape&&) noexcept = default;
+
+FileTape& FileTape::operator=(FileTape&&) noexcept = default;
+
+FileTape::~FileTape() = default;
+
 std::optional<int> FileTape::Read() {
-  std::this_thread::sleep_for(delay_config_.read_delay);
-  if (current_position_ == before_begin) {
-    return std::nullopt;
-  }
-  int value;
-  tape_stream_.read(reinterpret_cast<char*>(&value), sizeof(value));
-  if (tape_stream_.eof()) {
-    // Reset state
-    tape_stream_.clear();
-    return std::nullopt;
-  }
-  UpdatePosition(current_position_);
-  return value;
+  Delay(delay_config_.read_delay);
+  ++operation_counts_->reads;
+  is_streaming_ = true;
+  return ReadValue();
 }
 
 void FileTape::Write(int value) {
-  std::this_thread::sleep_for(delay_config_.write_delay);
-  if (current_position_ == before_begin) {
+  Delay(delay_config_.write_delay);
+  ++operation_counts_->writes;
+  is_streaming_ = true;
+  if (position_ == kBeforeBegin) {
     throw std::out_of_range(
         "Writing to the before begin position is prohibited\n");
   }
-  tape_stream_.write(reinterpret_cast<char*>(&value), sizeof(value));
-  UpdatePosition(current_position_);
+  storage_->Write(position_, value);
 }
 
 bool FileTape::MoveForward() {
-  std::this_thread::sleep_for(delay_config_.move_delay);
-  if (!Read()) {
+  Delay(GetMoveDelay(1));
+  ++operation_counts_->moves;
+  if (position_ == kBeforeBegin) {
+    position_ = 0;
+    return true;
+  }
+  // Probing for the end of the tape is a part of the move, not a read
+  if (!ReadValue()) {
     return false;
   }
-  UpdatePosition(current_position_ + std::streamoff(sizeof(int)));
+  ++position_;
 
   return true;
 }
 
 bool FileTape::MoveBackward() {
-  std::this_thread::sleep_for(delay_config_.move_delay);
-  if (current_position_ == before_begin) {
+  Delay(GetMoveDelay(-1));
+  ++operation_counts_->moves;
+  ++operation_counts_->backward_moves;
+  if (position_ == kBeforeBegin) {
     return false;
   }
-  UpdatePosition(current_position_ - std::streamoff(sizeof(int)));
+  --position_;
 
   return true;
 }
 
 void FileTape::Rewind() {
-  std::this_thread::sleep_for(delay_config_.rewind_delay);
-  // Reset state
-  tape_stream_.clear();
-  UpdatePosition(std::fstream::beg);
+  auto distance = std::max<int64_t>(position_, 0);
+  Delay(delay_config_.rewind_delay +
+        delay_config_.latency_model.rewind_delay_per_value * distance);
+  ++operation_counts_->rewinds;
+  position_ = 0;
+  // The tape stops at the beginning
+  direction_ = 0;
+  is_streaming_ = false;
+}
+
+void FileTape::Seek(uint64_t position) {
+  auto target = static_cast<int64_t>(position);
+  if (target < 0 || (target != 0 && !storage_->Read(target - 1))) {
+    throw std::out_of_range("Seeking beyond the end of the tape\n");
+  }
+  auto distance = std::abs(target - std::max<int64_t>(position_, 0));
+  Delay(delay_config_.rewind_delay +
+        delay_config_.latency_model.rewind_delay_per_value * distance);
+  ++operation_counts_->seeks;
+  position_ = target;
+  // The tape stops at the target
+  direction_ = 0;
+  is_streaming_ = false;
+}
+
+std::optional<uint64_t> FileTape::GetPosition() const {
+  if (position_ == kBeforeBegin) {
+    return std::nullopt;
+  }
+  return position_;
+}
+
+std::optional<int> FileTape::ReadForward() {
+  auto value = Read();
+  if (value) {
+    Shift(1);
+  }
+  return value;
+}
+
+std::optional<int> FileTape::ReadBackward() {
+  auto value = Read();
+  if (value) {
+    Shift(-1);
+  }
+  return value;
 }
 
-void FileTape::UpdatePosition(std::streampos position) {
-  current_position_ = position;
-  tape_stream_.seekg(current_position_);
-  tape_stream_.seekp(current_position_);
+void FileTape::WriteForward(int value) {
+  Write(value);
+  Shift(1);
+}
+
+std::optional<TapeMetadata> FileTape::GetMetadata() const {
+  if (!framed_storage_) {
+    return std::nullopt;
+  }
+  return framed_storage_->GetMetadata();
+}
+
+FileTapeFormat FileTape::GetFormat() const {
+  return framed_storage_ ? FileTapeFormat::kFramed : FileTapeFormat::kRaw;
+}
+
+bool FileTape::VerifyChecksums() {
+  return !framed_storage_ || framed_storage_->VerifyChecksums();
+}
+
+const TapeOperationCounts& FileTape::GetOperationCounts() const {
+  return *operation_counts_;
+}
+
+size_t FileTape::GetMemoryUsage(FileTapeBackend backend) {
+  if (backend == FileTapeBackend::kDirect) {
+    return sizeof(FileTape) + sizeof(DirectFileStorage) +
+           (DirectFileStorage::kDefaultQueueDepth + 1) *
+               DirectFileStorage::kDefaultBlockSize;
+  }
+  // The stream is unbuffered
+  return sizeof(FileTape) + sizeof(StreamFileStorage);
+}
+
+void FileTape::Flush() { storage_->Flush(); }
+
+std::optional<int> FileTape::ReadValue() {
+  if (position_ == kBeforeBegin) {
+    return std::nullopt;
+  }
+  return storage_->Read(position_);
+}
+
+void FileTape::Shift(int64_t offset) {
+  // The value under the head is known to exist, so the move cannot fail
+  ++operation_counts_->moves;
+  if (offset < 0) {
+    ++operation_counts_->backward_moves;
+  }
+  Delay(GetMoveDelay(offset));
+  position_ += offset;
+}
+
+std::chrono::microseconds FileTape::GetMoveDelay(int64_t offset) {
+  std::chrono::microseconds delay = offset < 0
+                                        ? delay_config_.GetMoveBackwardDelay()
+                                        : delay_config_.move_delay;
+  const auto& model = delay_config_.latency_model;
+  auto direction = offset < 0 ? -1 : 1;
+  if (direction != direction_) {
+    delay += model.start_stop_delay;
+  }
+  delay += (is_streaming_ ? model.streaming_delay : model.repositioning_delay) *
+           std::abs(offset);
+  direction_ = direction;
+  is_streaming_ = false;
+  return delay;
+}
+
+void FileTape::Delay(std::chrono::microseconds delay) {
+  if (delay_config_.jitter > 0) {
+    std::uniform_real_distribution<double> factor{1 - delay_config_.jitter,
+                                                  1 + delay_config_.jitter};
+    delay = std::chrono::duration_cast<std::chrono::microseconds>(
+        delay * factor(random_generator_));
+  }
+  operation_counts_->total_delay += delay;
+  // Short delays are slept in batches, a sleep is far longer than a
+  // microsecond
+  pending_delay_ += delay;
+  if (pending_delay_ >= std::chrono::milliseconds(1)) {
+    std::this_thread::sleep_for(pending_delay_);
+    pending_delay_ = std::chrono::microseconds::zero();
+  }
 }
 
-std::streampos FileTape::before_begin{std::fstream::beg -
-                                      std::streamoff(sizeof(int))};
 }  // namespace tape_sorter
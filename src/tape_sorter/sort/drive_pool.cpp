@@ -0,0 +1,185 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_sorter/sort/drive_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tape_sorter {
+
+class DrivePool::CartridgeTape : public ITape {
+ public:
+  CartridgeTape(std::unique_ptr<ITape> tape, DrivePool& pool, size_t cartridge)
+      : tape_(std::move(tape)), pool_(pool), cartridge_(cartridge) {}
+
+  ~CartridgeTape() override { pool_.Unmount(cartridge_); }
+
+  std::optional<int> Read() override {
+    pool_.Mount(cartridge_);
+    return tape_->Read();
+  }
+
+  void Write(int value) override {
+    pool_.Mount(cartridge_);
+    tape_->Write(value);
+  }
+
+  bool MoveForward() override {
+    pool_.Mount(cartridge_);
+    return tape_->MoveForward();
+  }
+
+  bool MoveBackward() override {
+    pool_.Mount(cartridge_);
+    return tape_->MoveBackward();
+  }
+
+  void Rewind() override {
+    pool_.Mount(cartridge_);
+    tape_->Rewind();
+  }
+
+  std::optional<int> ReadForward() override {
+    pool_.Mount(cartridge_);
+    return tape_->ReadForward();
+  }
+
+  std::optional<int> ReadBackward() override {
+    pool_.Mount(cartridge_);
+    return tape_->ReadBackward();
+  }
+
+  void WriteForward(int value) override {
+    pool_.Mount(cartridge_);
+    tape_->WriteForward(value);
+  }
+
+  const ITape* GetTape() const { return tape_.get(); }
+
+  size_t GetCartridge() const { return cartridge_; }
+
+ private:
+  std::unique_ptr<ITape> tape_;
+  DrivePool& pool_;
+  size_t cartridge_;
+};
+
+DrivePool::DrivePool(std::unique_ptr<ITempTapeCreator> temp_tape_creator,
+                     DrivePoolConfig config)
+    : temp_tape_creator_(std::move(temp_tape_creator)),
+      config_(config),
+      drives_(config.drives_number) {
+  if (config_.drives_number == 0) {
+    throw std::invalid_argument("Drive pool needs a drive at least\n");
+  }
+}
+
+std::unique_ptr<ITape> DrivePool::Create() {
+  return std::make_unique<CartridgeTape>(temp_tape_creator_->Create(), *this,
+                                         cartridges_number_++);
+}
+
+std::unique_ptr<ITape> DrivePool::CreateForMerge(
+    const std::vector<const ITape*>& source_tapes) {
+  std::vector<const ITape*> wrapped_tapes;
+  wrapped_tapes.reserve(source_tapes.size());
+  for (const auto* tape : source_tapes) {
+    const auto* cartridge = dynamic_cast<const CartridgeTape*>(tape);
+    wrapped_tapes.push_back(cartridge != nullptr ? cartridge->GetTape()
+                                                 : tape);
+  }
+  return std::make_unique<CartridgeTape>(
+      temp_tape_creator_->CreateForMerge(wrapped_tapes), *this,
+      cartridges_number_++);
+}
+
+size_t DrivePool::GetTapeMemoryUsage() const {
+  return temp_tape_creator_->GetTapeMemoryUsage();
+}
+
+void DrivePool::SetBufferArena(std::shared_ptr<BufferArena> buffer_arena) {
+  temp_tape_creator_->SetBufferArena(std::move(buffer_arena));
+}
+
+size_t DrivePool::GetMaxMountedTapes() const { return drives_.size(); }
+
+bool DrivePool::TakesDrive(const ITape& tape) const {
+  return dynamic_cast<const CartridgeTape*>(&tape) != nullptr;
+}
+
+bool DrivePool::IsMounted(const ITape& tape) const {
+  const auto* cartridge = dynamic_cast<const CartridgeTape*>(&tape);
+  if (cartridge == nullptr) {
+    return true;
+  }
+  return std::any_of(drives_.begin(), drives_.end(),
+                     [cartridge](const Drive& drive) {
+                       return drive.cartridge == cartridge->GetCartridge();
+                     });
+}
+
+std::chrono::microseconds DrivePool::GetModeledTime() const {
+  return temp_tape_creator_->GetModeledTime() + mount_time_;
+}
+
+size_t DrivePool::GetMountsNumber() const { return mounts_number_; }
+
+const std::vector<DriveEvent>& DrivePool::GetSchedule() const {
+  return schedule_;
+}
+
+void DrivePool::Mount(size_t cartridge) {
+  ++clock_;
+  auto mounted = std::find_if(
+      drives_.begin(), drives_.end(),
+      [cartridge](const Drive& drive) { return drive.cartridge == cartridge; });
+  if (mounted != drives_.end()) {
+    mounted->last_use = clock_;
+    return;
+  }
+
+  // A free drive has never been used or has been released
+  auto drive = std::min_element(drives_.begin(), drives_.end(),
+                                [](const Drive& lhs, const Drive& rhs) {
+                                  if (lhs.cartridge.has_value() !=
+                                      rhs.cartridge.has_value()) {
+                                    return !lhs.cartridge.has_value();
+                                  }
+                                  return lhs.last_use < rhs.last_use;
+                                });
+  auto drive_index = static_cast<size_t>(drive - drives_.begin());
+  if (drive->cartridge) {
+    schedule_.push_back(
+        {DriveEventKind::kUnmount, drive_index, *drive->cartridge});
+    mount_time_ += config_.unmount_delay;
+  }
+  schedule_.push_back({DriveEventKind::kMount, drive_index, cartridge});
+  mount_time_ += config_.mount_delay;
+  ++mounts_number_;
+  drive->cartridge = cartridge;
+  drive->last_use = clock_;
+}
+
+void DrivePool::Unmount(size_t cartridge) {
+  for (size_t i = 0; i != drives_.size(); ++i) {
+    if (drives_[i].cartridge == cartridge) {
+      schedule_.push_back({DriveEventKind::kUnmount, i, cartridge});
+      mount_time_ += config_.unmount_delay;
+      drives_[i].cartridge.reset();
+    }
+  }
+}
+
+}  // namespace tape_sorter
@@ -0,0 +1,178 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_sorter/sort/sort_service.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tape_sorter {
+
+struct SortService::Job {
+  ITape* input_tape;
+  ITape* output_tape;
+  std::unique_ptr<ITempTapeCreator> temp_tape_creator;
+  SortOptions options;
+  std::shared_ptr<MemoryGrant> memory_grant;
+  std::shared_ptr<SortProgress> progress;
+  SortJobState state{SortJobState::kQueued};
+  std::chrono::steady_clock::time_point start_time;
+  std::chrono::steady_clock::time_point finish_time;
+  std::optional<SortStatistics> statistics;
+  std::exception_ptr error;
+};
+
+SortService::SortService(SortServiceConfig config)
+    : config_(config),
+      max_running_jobs_number_(
+          std::min(config.threads_number,
+                   config.memory_budget.bytes /
+                       std::max<size_t>(config.min_job_memory, 1))),
+      buffer_arena_(std::make_shared<BufferArena>()),
+      thread_pool_(std::make_shared<ThreadPool>(config.threads_number)) {
+  if (max_running_jobs_number_ == 0) {
+    throw std::invalid_argument(
+        "Memory budget is smaller than the memory of a job\n");
+  }
+}
+
+SortService::~SortService() { WaitAll(); }
+
+SortJobId SortService::Submit(
+    ITape& input_tape, ITape& output_tape,
+    std::unique_ptr<ITempTapeCreator> temp_tape_creator, SortOptions options) {
+  auto job = std::make_unique<Job>();
+  job->input_tape = &input_tape;
+  job->output_tape = &output_tape;
+  job->temp_tape_creator = std::move(temp_tape_creator);
+  job->memory_grant = std::make_shared<MemoryGrant>(config_.min_job_memory);
+  job->progress = std::make_shared<SortProgress>();
+  options.buffer_arena = buffer_arena_;
+  options.thread_pool = thread_pool_;
+  options.memory_grant = job->memory_grant;
+  options.progress = job->progress;
+  job->options = std::move(options);
+
+  std::lock_guard lock(mutex_);
+  auto job_id = jobs_.size();
+  queued_jobs_.push_back(job.get());
+  jobs_.push_back(std::move(job));
+  AdmitJobs();
+  return job_id;
+}
+
+SortJobStatus SortService::GetStatus(SortJobId job_id) const {
+  std::lock_guard lock(mutex_);
+  const auto& job = *jobs_.at(job_id);
+  SortJobStatus status{job.state, job.progress->values_read,
+                       job.progress->values_written, 0,
+                       std::chrono::nanoseconds{0}, 0};
+  if (job.state == SortJobState::kQueued) {
+    return status;
+  }
+  auto end_time = job.state == SortJobState::kRunning
+                      ? std::chrono::steady_clock::now()
+                      : job.finish_time;
+  status.elapsed_time = end_time - job.start_time;
+  if (job.state == SortJobState::kRunning) {
+    status.granted_memory = job.memory_grant->GetBytes();
+  }
+  auto seconds = std::chrono::duration<double>(status.elapsed_time).count();
+  if (seconds > 0) {
+    status.values_per_second =
+        (status.values_read + status.values_written) / seconds;
+  }
+  return status;
+}
+
+SortStatistics SortService::Wait(SortJobId job_id) {
+  std::unique_lock lock(mutex_);
+  auto& job = *jobs_.at(job_id);
+  job_finished_.wait(lock, [&job] {
+    return job.state == SortJobState::kDone ||
+           job.state == SortJobState::kFailed;
+  });
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+  return job.statistics.value();
+}
+
+void SortService::WaitAll() {
+  std::unique_lock lock(mutex_);
+  job_finished_.wait(lock, [this] {
+    return queued_jobs_.empty() && running_jobs_.empty();
+  });
+}
+
+size_t SortService::GetRunningJobsNumber() const {
+  std::lock_guard lock(mutex_);
+  return running_jobs_.size();
+}
+
+void SortService::AdmitJobs() {
+  std::vector<Job*> admitted_jobs;
+  while (!queued_jobs_.empty() &&
+         running_jobs_.size() != max_running_jobs_number_) {
+    auto* job = queued_jobs_.front();
+    queued_jobs_.pop_front();
+    job->state = SortJobState::kRunning;
+    job->start_time = std::chrono::steady_clock::now();
+    running_jobs_.push_back(job);
+    admitted_jobs.push_back(job);
+  }
+  if (admitted_jobs.empty()) {
+    return;
+  }
+  // The shares are lowered before the new jobs start
+  SplitMemory();
+  for (auto* job : admitted_jobs) {
+    thread_pool_->Submit([this, job] { RunJob(*job); });
+  }
+}
+
+void SortService::SplitMemory() {
+  if (running_jobs_.empty()) {
+    return;
+  }
+  auto share = config_.memory_budget.bytes / running_jobs_.size();
+  for (auto* job : running_jobs_) {
+    job->memory_grant->SetBytes(share);
+  }
+}
+
+void SortService::RunJob(Job& job) {
+  std::optional<SortStatistics> statistics;
+  std::exception_ptr error;
+  try {
+    TapeSorter sorter(MemoryBudget{config_.min_job_memory},
+                      std::move(job.temp_tape_creator), job.options);
+    statistics = sorter.Sort(*job.input_tape, *job.output_tape);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  std::lock_guard lock(mutex_);
+  job.state = error ? SortJobState::kFailed : SortJobState::kDone;
+  job.finish_time = std::chrono::steady_clock::now();
+  job.statistics = std::move(statistics);
+  job.error = error;
+  running_jobs_.erase(
+      std::find(running_jobs_.begin(), running_jobs_.end(), &job));
+  SplitMemory();
+  AdmitJobs();
+  job_finished_.notify_all();
+}
+
+}  // namespace tape_sorter
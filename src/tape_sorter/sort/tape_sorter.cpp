@@ -14,65 +14,560 @@
 
 #include "tape_sorter/sort/tape_sorter.h"
 
-#include "tapes_priority_queue.h"
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace tape_sorter {
 
 namespace {
 
-std::vector<int> ReadBlock(ITape& input_tape, size_t buffer_size) {
-  std::vector<int> block;
-  block.reserve(buffer_size);
+// Memory of the merge priority queue per run
+constexpr size_t kMergeItemSize = 4 * sizeof(void*);
 
-  for (auto i = 0; i != buffer_size && input_tape.Read(); ++i) {
-    auto value = input_tape.Read().value();
-    block.push_back(value);
-    input_tape.MoveForward();
-  }
-  return block;
+// Values read at once by the counting sort, their keys are grouped by window
+// of the counts in a scratch buffer of the same size
+constexpr size_t kMaxCountingChunkSize = 1 << 14;
+
+uint64_t GetKeysNumber(const KeyRange& key_range) {
+  return static_cast<int64_t>(key_range.max) - key_range.min + 1;
 }
 
-void WriteBlock(ITape& input_tape, const std::vector<int>& block) {
-  for (auto value : block) {
-    input_tape.Write(value);
-    input_tape.MoveForward();
+class MemoryRunTape : public ITape {
+ public:
+  MemoryRunTape(BufferArena::Buffer buffer, size_t size)
+      : buffer_(std::move(buffer)), size_(size) {}
+
+  std::optional<int> Read() override {
+    if (position_ == size_) {
+      return std::nullopt;
+    }
+    return buffer_.Data<int>()[position_];
+  }
+
+  void Write(int /*value*/) override {
+    throw std::logic_error("A memory run is read only\n");
+  }
+
+  bool MoveForward() override {
+    if (position_ == size_) {
+      return false;
+    }
+    ++position_;
+    return true;
+  }
+
+  bool MoveBackward() override {
+    if (position_ == 0) {
+      return false;
+    }
+    --position_;
+    return true;
   }
+
+  void Rewind() override { position_ = 0; }
+
+  std::optional<int> ReadForward() override {
+    if (position_ == size_) {
+      return std::nullopt;
+    }
+    return buffer_.Data<int>()[position_++];
+  }
+
+ private:
+  BufferArena::Buffer buffer_;
+  size_t size_;
+  size_t position_{0};
+};
+
+size_t GetMaxOpenTapes() {
+  constexpr size_t kDefaultMaxOpenTapes = 1024;
+  rlimit limit{};
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+      limit.rlim_cur == RLIM_INFINITY) {
+    return kDefaultMaxOpenTapes;
+  }
+  // A tape may use several descriptors, and the rest of the process needs
+  // some as well
+  return std::max<size_t>(limit.rlim_cur / 4, 2);
 }
 
 }  // namespace
 
-TapeSorter::TapeSorter(size_t max_buffer_size,
-                       std::unique_ptr<ITempTapeCreator> temp_tape_creator)
+TapeSorterBase::TapeSorterBase(
+    size_t max_buffer_size, std::unique_ptr<ITempTapeCreator> temp_tape_creator,
+    SortOptions options)
     : max_buffer_size_(max_buffer_size),
-      temp_tape_creator_(std::move(temp_tape_creator)) {}
+      max_runs_number_(GetMaxOpenTapes()),
+      temp_tape_creator_(std::move(temp_tape_creator)),
+      options_(std::move(options)) {
+  if (!options_.buffer_arena) {
+    options_.buffer_arena = std::make_shared<BufferArena>();
+  }
+  options_.threads_number = std::max<size_t>(options_.threads_number, 1);
+  if (options_.key_range && options_.key_range->min > options_.key_range->max) {
+    throw std::invalid_argument("Key range is empty\n");
+  }
+  temp_tape_creator_->SetBufferArena(options_.buffer_arena);
+  if (auto drives_number = temp_tape_creator_->GetMaxMountedTapes()) {
+    // Merging two runs into a third one is the least to make progress
+    if (drives_number < 3) {
+      throw std::invalid_argument(
+          "Three temporary tapes at least must be usable at once\n");
+    }
+    // The output of a merge needs a drive as well
+    max_merge_ways_ = drives_number - 1;
+  }
+}
+
+TapeSorterBase::TapeSorterBase(
+    MemoryBudget memory_budget,
+    std::unique_ptr<ITempTapeCreator> temp_tape_creator, SortOptions options)
+    : TapeSorterBase(0, std::move(temp_tape_creator), std::move(options)) {
+  memory_budget_ = memory_budget;
+  auto tape_memory = temp_tape_creator_->GetTapeMemoryUsage();
+  auto run_memory = tape_memory + kMergeItemSize;
+  // Half of the budget is left for the block, the runs share the rest with
+  // the tape being written
+  auto runs_memory = memory_budget.bytes / 2;
+  if (runs_memory < tape_memory + 2 * run_memory) {
+    throw std::invalid_argument(
+        "Memory budget is too small for the temporary tapes\n");
+  }
+  max_runs_number_ = std::min((runs_memory - tape_memory) / run_memory,
+                              max_runs_number_);
+  // The ring is taken from the half of the block
+  if (options_.write_behind_buffer_size != 0 &&
+      WriteBehindTape::GetMemoryUsage(options_.write_behind_buffer_size) >
+          memory_budget.bytes / 4) {
+    throw std::invalid_argument(
+        "Memory budget is too small for the write-behind buffer\n");
+  }
+}
+
+size_t TapeSorterBase::GetBlockSize(size_t runs_number) const {
+  if (!memory_budget_) {
+    return max_buffer_size_;
+  }
+  auto budget = memory_budget_->bytes;
+  if (options_.memory_grant) {
+    budget = std::max(budget, options_.memory_grant->GetBytes());
+  }
+  auto tape_memory = temp_tape_creator_->GetTapeMemoryUsage();
+  auto runs_memory = (runs_number + 1) * tape_memory +
+                     runs_number * kMergeItemSize;
+  auto block_memory = budget - runs_memory;
+  if (options_.write_behind_buffer_size != 0) {
+    // the ring of the output, open during the whole sort
+    block_memory -= std::min(
+        block_memory,
+        WriteBehindTape::GetMemoryUsage(options_.write_behind_buffer_size));
+  }
+  if (options_.threads_number > 1 || stability_ == SortStability::kStable) {
+    // the scratch buffer of the parallel or stable sort
+    block_memory /= 2;
+  }
+  return block_memory / sizeof(int);
+}
 
-void TapeSorter::Sort(ITape& input_tape, ITape& output_tape) const {
-  TapesPriorityQueue tapes_queue{SplitIntoSortedSubTapes(input_tape)};
+std::pair<size_t, size_t> TapeSorterBase::GetShortestRuns(
+    const std::vector<Run>& runs) const {
+  // Only adjacent runs are merged, so the runs stay in the order of the input
+  // and stable sorts keep equivalent values in order
+  auto lowest_level = std::min_element(runs.begin(), runs.end(),
+                                       [](const Run& lhs, const Run& rhs) {
+                                         return lhs.level < rhs.level;
+                                       })
+                          ->level;
+  auto takes_drive = [this](const Run& run) {
+    return temp_tape_creator_->TakesDrive(*run.tape);
+  };
+  // Of the candidates, the runs which take the fewest mounts, then the most
+  // runs, then the first ones. The cartridges written or merged last are
+  // still mounted, while the first ones were evicted long ago.
+  std::pair<size_t, size_t> shortest_runs;
+  std::optional<std::pair<size_t, size_t>> min_cost;
+  auto add_candidate = [&](size_t first, size_t runs_number) {
+    size_t mounts_number = 0;
+    for (size_t i = first; i != first + runs_number; ++i) {
+      if (!temp_tape_creator_->IsMounted(*runs[i].tape)) {
+        ++mounts_number;
+      }
+    }
+    std::pair<size_t, size_t> cost{mounts_number, runs.size() - runs_number};
+    if (!min_cost || cost < *min_cost) {
+      min_cost = cost;
+      shortest_runs = {first, runs_number};
+    }
+  };
+  // Runs of a stretch of the lowest level are taken from either end, so no
+  // lone run is left in it. Runs kept in memory take no drive.
+  for (size_t begin = 0; begin != runs.size();) {
+    if (runs[begin].level != lowest_level) {
+      ++begin;
+      continue;
+    }
+    auto end = begin;
+    while (end != runs.size() && runs[end].level == lowest_level) {
+      ++end;
+    }
+    auto last = begin;
+    size_t drives_number = 0;
+    while (last != end &&
+           (!takes_drive(runs[last]) || drives_number != max_merge_ways_)) {
+      drives_number += takes_drive(runs[last]) ? 1 : 0;
+      ++last;
+    }
+    auto first = end;
+    drives_number = 0;
+    while (first != begin && (!takes_drive(runs[first - 1]) ||
+                              drives_number != max_merge_ways_)) {
+      --first;
+      drives_number += takes_drive(runs[first]) ? 1 : 0;
+    }
+    if (last - begin > 1) {
+      add_candidate(begin, last - begin);
+      add_candidate(first, end - first);
+    } else {
+      // A lone run is taken with a neighbour
+      if (begin != 0) {
+        add_candidate(begin - 1, 2);
+      }
+      if (end != runs.size()) {
+        add_candidate(begin, 2);
+      }
+    }
+    begin = end;
+  }
+  return shortest_runs;
+}
 
-  while (!tapes_queue.Empty()) {
-    auto min = tapes_queue.Top();
-    tapes_queue.Pop();
-    output_tape.Write(min);
-    output_tape.MoveForward();
+size_t TapeSorterBase::GetDriveRunsNumber(const std::vector<Run>& runs) const {
+  return std::count_if(runs.begin(), runs.end(), [this](const Run& run) {
+    return temp_tape_creator_->TakesDrive(*run.tape);
+  });
+}
+
+void TapeSorterBase::ReplaceRuns(std::vector<Run>& runs, size_t first,
+                                 size_t runs_number,
+                                 std::unique_ptr<ITape> tape,
+                                 SortStatistics& statistics) {
+  auto begin = runs.begin() + first;
+  auto end = begin + runs_number;
+  size_t level = 0;
+  size_t values_number = 0;
+  for (auto run = begin; run != end; ++run) {
+    level = std::max(level, run->level + 1);
+    values_number += run->values_number;
   }
+  *begin = {std::move(tape), RunLayout::kForward, level, values_number};
+  runs.erase(begin + 1, end);
+  ++statistics.early_merges_number;
+  statistics.schedule.push_back(
+      {SortStepKind::kEarlyMerge, runs_number, values_number});
 }
 
-std::vector<std::unique_ptr<ITape>> TapeSorter::SplitIntoSortedSubTapes(
-    ITape& input_tape) const {
-  std::vector<std::unique_ptr<ITape>> subtapes;
-  while (input_tape.Read()) {
-    auto block = ReadBlock(input_tape, max_buffer_size_);
-    // sort descending
-    std::sort(block.begin(), block.end(),
-              [](auto&& lhs, auto&& rhs) { return lhs > rhs; });
-    auto temp_tape = temp_tape_creator_->Create();
-    WriteBlock(*temp_tape, block);
-    // move to last (min) element
-    temp_tape->MoveBackward();
-    subtapes.push_back(std::move(temp_tape));
+std::vector<MergeSource> TapeSorterBase::GetSources(
+    const std::vector<Run>& runs, size_t first, size_t runs_number) {
+  std::vector<MergeSource> sources;
+  sources.reserve(runs_number);
+  for (size_t i = first; i != first + runs_number; ++i) {
+    sources.push_back({runs[i].tape.get(), runs[i].layout});
   }
+  return sources;
+}
 
-  return subtapes;
+size_t TapeSorterBase::ReadBlock(ITape& input_tape, int* block,
+                                 size_t buffer_size) {
+  size_t size = 0;
+  while (size != buffer_size) {
+    auto value = input_tape.ReadForward();
+    if (!value) {
+      break;
+    }
+    block[size++] = value.value();
+  }
+  return size;
+}
+
+void TapeSorterBase::WriteBlock(ITape& tape, const int* block, size_t size) {
+  for (size_t i = 0; i != size; ++i) {
+    tape.WriteForward(block[i]);
+  }
+}
+
+void TapeSorterBase::WriteBlockReversed(ITape& tape, const int* block,
+                                        size_t size) {
+  for (size_t i = size; i != 0; --i) {
+    tape.WriteForward(block[i - 1]);
+  }
+}
+
+std::unique_ptr<ITape> TapeSorterBase::CreateMemoryRun(
+    BufferArena::Buffer buffer, size_t size) {
+  return std::make_unique<MemoryRunTape>(std::move(buffer), size);
+}
+
+void TapeSorterBase::CountInputValues(const int* values, size_t size,
+                                      MultisetChecksum& input_checksum) const {
+  if (options_.progress) {
+    options_.progress->values_read += size;
+  }
+  if (options_.verify) {
+    for (size_t i = 0; i != size; ++i) {
+      input_checksum.Add(values[i]);
+    }
+  }
+}
+
+size_t TapeSorterBase::GetBucketsNumber(
+    std::optional<uint64_t> values_number, size_t open_tapes_number) const {
+  constexpr size_t kDefaultBucketsNumber = 64;
+  // The buckets are written at once, and an oversized one is sorted while
+  // the rest are open, with two runs or buckets of its own
+  auto max_tapes_number = std::min(max_runs_number_, max_merge_ways_);
+  auto max_buckets_number =
+      max_tapes_number > open_tapes_number + 4
+          ? max_tapes_number - open_tapes_number - 2
+          : 2;
+  if (!values_number) {
+    // Within a budget the buckets take the memory left to the runs, so large
+    // inputs are not split into oversized ones
+    return memory_budget_
+               ? max_buckets_number
+               : std::min(kDefaultBucketsNumber, max_buckets_number);
+  }
+  // A quarter more buckets than blocks leaves room for uneven ones
+  auto block_size = std::max<size_t>(GetBlockSize(open_tapes_number), 1);
+  auto blocks_number = (*values_number + block_size - 1) / block_size;
+  return std::clamp<size_t>(blocks_number + blocks_number / 4 + 1, 2,
+                            max_buckets_number);
+}
+
+void TapeSorterBase::CopyValues(ITape& input_tape, ITape& output_tape,
+                                MultisetChecksum& input_checksum,
+                                SortStatistics& statistics) const {
+  auto start = Clock::now();
+  while (auto value = input_tape.ReadForward()) {
+    output_tape.WriteForward(value.value());
+    if (options_.verify) {
+      input_checksum.Add(value.value());
+    }
+    ++statistics.values_number;
+  }
+  if (options_.progress) {
+    options_.progress->values_read += statistics.values_number;
+  }
+  statistics.schedule.push_back(
+      {SortStepKind::kCopy, 1, statistics.values_number});
+  statistics.merge_time = Clock::now() - start;
+}
+
+size_t TapeSorterBase::GetMergeLevelsNumber(
+    std::optional<uint64_t> values_number) const {
+  if (!values_number) {
+    return 1;
+  }
+  auto block_size = std::max<size_t>(GetBlockSize(0), 1);
+  auto merge_ways =
+      std::max<size_t>(std::min(max_runs_number_, max_merge_ways_), 2);
+  auto runs_number = (*values_number + block_size - 1) / block_size;
+  size_t levels_number = 1;
+  while (runs_number > merge_ways) {
+    runs_number = (runs_number + merge_ways - 1) / merge_ways;
+    ++levels_number;
+  }
+  return levels_number;
+}
+
+auto TapeSorterBase::PlanCounting(
+    const std::optional<TapeMetadata>& metadata, bool is_seekable) const
+    -> std::optional<CountingPlan> {
+  if (options_.engine != SortEngine::kCounting) {
+    return std::nullopt;
+  }
+  auto fall_back = [this](const char* reason) -> std::optional<CountingPlan> {
+    if (options_.strict_engine) {
+      throw std::invalid_argument(reason);
+    }
+    return std::nullopt;
+  };
+  auto key_range = options_.key_range;
+  if (!key_range && metadata) {
+    key_range = KeyRange{metadata->min, metadata->max};
+  }
+  // Finding the range would take a pass of its own
+  if (!key_range) {
+    return fall_back("Counting needs the key range of the input\n");
+  }
+  auto keys_number = GetKeysNumber(*key_range);
+  auto block_memory = GetBlockSize(0) * sizeof(int);
+  auto chunk_size = std::clamp<size_t>(block_memory / sizeof(int) / 4, 1,
+                                       kMaxCountingChunkSize);
+  auto chunk_memory = chunk_size * (sizeof(int) + sizeof(uint32_t));
+  // The block memory left by the chunk holds the counts of a partition
+  uint64_t partition_size = std::max<size_t>(
+      block_memory > chunk_memory
+          ? (block_memory - chunk_memory) / sizeof(uint32_t)
+          : 0,
+      1);
+  auto passes_number = (keys_number + partition_size - 1) / partition_size;
+  // The head of a stream does not come back for another pass
+  if (passes_number > 1 && !is_seekable) {
+    return fall_back("Counting the key range takes more than one pass\n");
+  }
+  // Each pass reads the input, the merge reads it once and writes and reads
+  // it once more a level
+  std::optional<uint64_t> values_number;
+  if (metadata) {
+    values_number = metadata->values_number;
+  }
+  if (passes_number > 1 + 2 * GetMergeLevelsNumber(values_number)) {
+    return fall_back("Counting the key range takes more passes than a merge\n");
+  }
+  return CountingPlan{*key_range, chunk_size,
+                      std::min(partition_size, keys_number)};
+}
+
+void TapeSorterBase::SortByCounting(ITape& input_tape, ITape& output_tape,
+                                    const CountingPlan& plan,
+                                    bool is_descending,
+                                    MultisetChecksum& input_checksum,
+                                    SortStatistics& statistics) const {
+  // The counts of a window stay in the L2 cache while its keys are counted
+  constexpr size_t kWindowBits = 15;
+  const auto& key_range = plan.key_range;
+  auto chunk_size = plan.chunk_size;
+  auto chunk_buffer = options_.buffer_arena->Acquire(
+      chunk_size * (sizeof(int) + sizeof(uint32_t)));
+  auto* chunk = chunk_buffer.Data<int>();
+  auto* keys = reinterpret_cast<uint32_t*>(chunk + chunk_size);
+  // Where the sort found the head, not necessarily the first value of the
+  // tape
+  auto start_position = input_tape.GetPosition();
+  auto is_input_read = false;
+  // The values are added to the progress and the checksum in the first pass
+  auto read_input = [&](auto visit_chunk) {
+    auto is_first_pass = !is_input_read;
+    if (is_input_read) {
+      if (!start_position) {
+        throw std::logic_error(
+            "Input tape does not seek back for another counting pass\n");
+      }
+      input_tape.Seek(*start_position);
+    }
+    size_t size = 0;
+    do {
+      size = ReadBlock(input_tape, chunk, chunk_size);
+      if (is_first_pass) {
+        statistics.values_number += size;
+        CountInputValues(chunk, size, input_checksum);
+      }
+      visit_chunk(size, is_first_pass);
+    } while (size == chunk_size);
+    is_input_read = true;
+  };
+
+  auto keys_number = GetKeysNumber(key_range);
+  auto partition_size = plan.partition_size;
+  auto partitions_number = (keys_number + partition_size - 1) / partition_size;
+  auto counts_buffer =
+      options_.buffer_arena->Acquire(partition_size * sizeof(uint32_t));
+  auto* counts = counts_buffer.Data<uint32_t>();
+  // Keys which occurred 2^32 times or more, with their counts in units of
+  // 2^32, so a pass covers twice the keys of 64-bit counts
+  std::unordered_map<uint64_t, uint64_t> count_carries;
+  auto count = [&](uint64_t key) {
+    if (++counts[key] == 0) {
+      ++count_carries[key];
+    }
+  };
+  auto windows_number = ((partition_size - 1) >> kWindowBits) + 1;
+  std::vector<size_t> window_offsets(windows_number + 1);
+
+  uint64_t written_values_number = 0;
+  for (uint64_t pass = 0; pass != partitions_number; ++pass) {
+    // Every value is written, the partitions left are empty
+    if (is_input_read && written_values_number == statistics.values_number) {
+      break;
+    }
+    auto partition = is_descending ? partitions_number - 1 - pass : pass;
+    auto first =
+        key_range.min + static_cast<int64_t>(partition * partition_size);
+    auto partition_keys =
+        std::min(partition_size, keys_number - partition * partition_size);
+    auto count_start = Clock::now();
+    std::fill_n(counts, partition_keys, 0);
+    count_carries.clear();
+    read_input([&](size_t size, bool is_first_pass) {
+      if (is_first_pass) {
+        for (size_t i = 0; i != size; ++i) {
+          if (chunk[i] < key_range.min || chunk[i] > key_range.max) {
+            throw std::out_of_range("Value out of the key range\n");
+          }
+        }
+      }
+      if (windows_number == 1) {
+        for (size_t i = 0; i != size; ++i) {
+          auto key = static_cast<uint64_t>(chunk[i] - first);
+          if (key < partition_keys) {
+            count(key);
+          }
+        }
+        return;
+      }
+      // Keys of the partition grouped by window, then counted window by
+      // window
+      std::fill(window_offsets.begin(), window_offsets.end(), 0);
+      for (size_t i = 0; i != size; ++i) {
+        auto key = static_cast<uint64_t>(chunk[i] - first);
+        if (key < partition_keys) {
+          ++window_offsets[(key >> kWindowBits) + 1];
+        }
+      }
+      std::partial_sum(window_offsets.begin(), window_offsets.end(),
+                       window_offsets.begin());
+      auto grouped_keys_number = window_offsets.back();
+      for (size_t i = 0; i != size; ++i) {
+        auto key = static_cast<uint64_t>(chunk[i] - first);
+        if (key < partition_keys) {
+          keys[window_offsets[key >> kWindowBits]++] =
+              static_cast<uint32_t>(key);
+        }
+      }
+      for (size_t i = 0; i != grouped_keys_number; ++i) {
+        count(keys[i]);
+      }
+    });
+    auto write_start = Clock::now();
+    statistics.run_generation_time += write_start - count_start;
+
+    uint64_t partition_values_number = 0;
+    for (uint64_t i = 0; i != partition_keys; ++i) {
+      auto key = is_descending ? partition_keys - 1 - i : i;
+      auto value = static_cast<int>(first + static_cast<int64_t>(key));
+      uint64_t key_count = counts[key];
+      if (!count_carries.empty()) {
+        if (auto carry = count_carries.find(key);
+            carry != count_carries.end()) {
+          key_count += carry->second << 32;
+        }
+      }
+      for (auto left = key_count; left != 0; --left) {
+        output_tape.WriteForward(value);
+      }
+      partition_values_number += key_count;
+    }
+    written_values_number += partition_values_number;
+    statistics.schedule.push_back(
+        {SortStepKind::kCount, 1, partition_values_number});
+    statistics.merge_time += Clock::now() - write_start;
+  }
 }
 
 }  // namespace tape_sorter
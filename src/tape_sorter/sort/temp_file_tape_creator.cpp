@@ -14,23 +14,178 @@
 
 #include "tape_sorter/sort/temp_file_tape_creator.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
 namespace tape_sorter {
 
 namespace {
 
-fs::path CreateTemporaryFilePath() {
-  // NOTE: not thread safe
-  return fs::path(std::tmpnam(nullptr));
+// Removes its file when destroyed
+class TempFileTape : public FileTape {
+ public:
+  TempFileTape(const fs::path& file_path, TapeDelayConfig config,
+               FileTapeBackend backend,
+               std::shared_ptr<TapeOperationCounts> operation_counts,
+               std::shared_ptr<BufferArena> buffer_arena,
+               const TempFileTapeCreator* creator, size_t directory)
+      : FileTape(file_path, std::move(config), backend,
+                 std::move(operation_counts), std::move(buffer_arena)),
+        file_path_(file_path),
+        creator_(creator),
+        directory_(directory) {}
+
+  ~TempFileTape() override {
+    // The file stays open until the base is destroyed, which is fine
+    std::error_code error;
+    fs::remove(file_path_, error);
+  }
+
+  const TempFileTapeCreator* GetCreator() const { return creator_; }
+
+  size_t GetDirectory() const { return directory_; }
+
+ private:
+  fs::path file_path_;
+  const TempFileTapeCreator* creator_;
+  size_t directory_;
+};
+
+fs::path CreateTemporaryFilePath(const fs::path& directory) {
+  static std::atomic<uint64_t> counter{0};
+  auto file_path = directory / ("tape_sorter." + std::to_string(::getpid()) +
+                                "." + std::to_string(counter++));
+  // Left by a previous process with the same id
+  std::error_code error;
+  fs::remove(file_path, error);
+  return file_path;
+}
+
+// Directories on one device share its bandwidth
+uint64_t GetDevice(const fs::path& directory, size_t index) {
+  struct stat info {};
+  if (::stat(directory.c_str(), &info) != 0) {
+    // Unknown devices are told apart
+    return std::numeric_limits<uint64_t>::max() - index;
+  }
+  return info.st_dev;
 }
 
 }  // namespace
 
-TempFileTapeCreator::TempFileTapeCreator(TapeDelayConfig config)
-    : config_(std::move(config)) {}
+TempFileTapeCreator::TempFileTapeCreator(TapeDelayConfig config,
+                                         FileTapeBackend backend,
+                                         std::vector<TempDirectory> directories,
+                                         TempPlacement placement)
+    : config_(std::move(config)),
+      backend_(backend),
+      directories_(std::move(directories)),
+      placement_(placement),
+      operation_counts_(std::make_shared<TapeOperationCounts>()) {
+  if (directories_.empty()) {
+    directories_.emplace_back(fs::temp_directory_path());
+  }
+  for (size_t i = 0; i != directories_.size(); ++i) {
+    if (!(directories_[i].weight > 0)) {
+      throw std::invalid_argument(
+          "Weight of a temporary directory must be positive\n");
+    }
+    devices_.push_back(GetDevice(directories_[i].path, i));
+  }
+  current_weights_.resize(directories_.size());
+}
 
 std::unique_ptr<ITape> TempFileTapeCreator::Create() {
-  auto temp_file = CreateTemporaryFilePath();
-  return std::make_unique<FileTape>(temp_file, config_);
+  return CreateInDirectory(
+      ChooseDirectory(std::vector<bool>(directories_.size())));
+}
+
+std::unique_ptr<ITape> TempFileTapeCreator::CreateForMerge(
+    const std::vector<const ITape*>& source_tapes) {
+  std::vector<bool> is_read(directories_.size());
+  for (const auto* tape : source_tapes) {
+    const auto* temp_tape = dynamic_cast<const TempFileTape*>(tape);
+    if (temp_tape != nullptr && temp_tape->GetCreator() == this) {
+      is_read[temp_tape->GetDirectory()] = true;
+    }
+  }
+  std::vector<bool> is_on_read_device(directories_.size());
+  for (size_t i = 0; i != directories_.size(); ++i) {
+    for (size_t j = 0; j != directories_.size(); ++j) {
+      if (is_read[j] && devices_[i] == devices_[j]) {
+        is_on_read_device[i] = true;
+      }
+    }
+  }
+  auto is_every_device_read = std::all_of(
+      is_on_read_device.begin(), is_on_read_device.end(),
+      [](bool is_read_device) { return is_read_device; });
+  return CreateInDirectory(
+      ChooseDirectory(is_every_device_read ? is_read : is_on_read_device));
+}
+
+size_t TempFileTapeCreator::GetTapeMemoryUsage() const {
+  return FileTape::GetMemoryUsage(backend_);
+}
+
+void TempFileTapeCreator::SetBufferArena(
+    std::shared_ptr<BufferArena> buffer_arena) {
+  buffer_arena_ = std::move(buffer_arena);
+}
+
+std::chrono::microseconds TempFileTapeCreator::GetModeledTime() const {
+  return operation_counts_->total_delay;
+}
+
+const TapeOperationCounts& TempFileTapeCreator::GetOperationCounts() const {
+  return *operation_counts_;
+}
+
+size_t TempFileTapeCreator::GetCreatedTapesNumber() const {
+  return created_tapes_number_;
+}
+
+size_t TempFileTapeCreator::ChooseDirectory(
+    const std::vector<bool>& is_excluded) {
+  auto is_every_excluded = std::all_of(
+      is_excluded.begin(), is_excluded.end(),
+      [](bool is_directory_excluded) { return is_directory_excluded; });
+  size_t chosen = directories_.size();
+  double total_weight = 0;
+  for (size_t i = 0; i != directories_.size(); ++i) {
+    if (is_excluded[i] && !is_every_excluded) {
+      continue;
+    }
+    auto weight = directories_[i].weight;
+    if (placement_ == TempPlacement::kFreeSpace) {
+      std::error_code error;
+      auto space = fs::space(directories_[i].path, error);
+      weight *= error ? 0 : static_cast<double>(space.available);
+    }
+    current_weights_[i] += weight;
+    total_weight += weight;
+    if (chosen == directories_.size() ||
+        current_weights_[i] > current_weights_[chosen]) {
+      chosen = i;
+    }
+  }
+  current_weights_[chosen] -= total_weight;
+  return chosen;
+}
+
+std::unique_ptr<ITape> TempFileTapeCreator::CreateInDirectory(
+    size_t directory) {
+  auto temp_file = CreateTemporaryFilePath(directories_[directory].path);
+  ++created_tapes_number_;
+  return std::make_unique<TempFileTape>(temp_file, config_, backend_,
+                                        operation_counts_, buffer_arena_, this,
+                                        directory);
 }
 
 }  // namespace tape_sorter
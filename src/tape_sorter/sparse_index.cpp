@@ -0,0 +1,140 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_sorter/sparse_index.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace tape_sorter {
+
+namespace {
+
+constexpr std::array<char, 8> kMagic = {'\x89', 'T', 'I', 'D',
+                                        'X',    '\r', '\n', '\x1a'};
+constexpr uint16_t kVersion = 1;
+
+template <typename T>
+void WriteField(std::ofstream& file, T value) {
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T ReadField(std::ifstream& file) {
+  T value;
+  if (!file.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+    throw std::runtime_error("Sparse index file is truncated\n");
+  }
+  return value;
+}
+
+}  // namespace
+
+SparseIndex::SparseIndex(size_t stride) : stride_(stride) {
+  if (stride_ == 0) {
+    throw std::invalid_argument("Sparse index stride must be positive\n");
+  }
+}
+
+void SparseIndex::Add(int value) {
+  if (values_number_ % stride_ == 0) {
+    entries_.push_back({value, values_number_});
+  }
+  ++values_number_;
+}
+
+void SparseIndex::Clear() {
+  values_number_ = 0;
+  entries_.clear();
+}
+
+size_t SparseIndex::GetStride() const { return stride_; }
+
+uint64_t SparseIndex::GetValuesNumber() const { return values_number_; }
+
+const std::vector<SparseIndex::Entry>& SparseIndex::GetEntries() const {
+  return entries_;
+}
+
+fs::path SparseIndex::GetSidecarPath(const fs::path& tape_path) {
+  auto path = tape_path;
+  path += ".idx";
+  return path;
+}
+
+void SparseIndex::Save(const fs::path& path) const {
+  std::ofstream file(path, std::ofstream::binary | std::ofstream::trunc);
+  file.write(kMagic.data(), kMagic.size());
+  WriteField(file, kVersion);
+  WriteField<uint64_t>(file, stride_);
+  WriteField(file, values_number_);
+  WriteField<uint64_t>(file, entries_.size());
+  for (const auto& entry : entries_) {
+    WriteField(file, entry.key);
+    WriteField(file, entry.position);
+  }
+  if (!file.flush()) {
+    throw std::runtime_error("Failed to write the sparse index file\n");
+  }
+}
+
+SparseIndex SparseIndex::Load(const fs::path& path) {
+  std::ifstream file(path, std::ifstream::binary);
+  std::array<char, kMagic.size()> magic{};
+  if (!file.read(magic.data(), magic.size()) || magic != kMagic) {
+    throw std::runtime_error("Not a sparse index file\n");
+  }
+  if (ReadField<uint16_t>(file) != kVersion) {
+    throw std::runtime_error("Unsupported sparse index version\n");
+  }
+  auto stride = ReadField<uint64_t>(file);
+  if (stride == 0) {
+    throw std::runtime_error("Sparse index file is corrupted\n");
+  }
+  SparseIndex index(stride);
+  index.values_number_ = ReadField<uint64_t>(file);
+  auto entries_number = ReadField<uint64_t>(file);
+  if (entries_number != (index.values_number_ + stride - 1) / stride) {
+    throw std::runtime_error("Sparse index file is corrupted\n");
+  }
+  index.entries_.reserve(entries_number);
+  for (uint64_t i = 0; i != entries_number; ++i) {
+    auto key = ReadField<int>(file);
+    auto position = ReadField<uint64_t>(file);
+    index.entries_.push_back({key, position});
+  }
+  return index;
+}
+
+IndexingTape::IndexingTape(ITape& tape, SparseIndex& index)
+    : tape_(tape), index_(index) {}
+
+std::optional<int> IndexingTape::Read() { return tape_.Read(); }
+
+void IndexingTape::Write(int value) { tape_.Write(value); }
+
+bool IndexingTape::MoveForward() { return tape_.MoveForward(); }
+
+bool IndexingTape::MoveBackward() { return tape_.MoveBackward(); }
+
+void IndexingTape::Rewind() { tape_.Rewind(); }
+
+void IndexingTape::WriteForward(int value) {
+  tape_.WriteForward(value);
+  index_.Add(value);
+}
+
+}  // namespace tape_sorter
@@ -0,0 +1,285 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "async_file_io.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <initializer_list>
+#include <system_error>
+#include <vector>
+
+namespace tape_sorter {
+
+namespace {
+
+// Whether the ring supports the operations, their support was probed first
+// by the kernel that added them (5.6)
+bool AreOpsSupported(int ring_fd, std::initializer_list<uint8_t> opcodes) {
+  constexpr unsigned kProbedOps = 256;
+  std::vector<char> buffer(sizeof(io_uring_probe) +
+                           kProbedOps * sizeof(io_uring_probe_op));
+  auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+  if (::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe,
+                kProbedOps) < 0) {
+    return false;
+  }
+  return std::all_of(opcodes.begin(), opcodes.end(), [probe](uint8_t opcode) {
+    return opcode <= probe->last_op &&
+           (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+  });
+}
+
+class PosixFileIo : public IAsyncFileIo {
+ public:
+  void SubmitRead(int fd, void* buffer, size_t size, int64_t offset,
+                  IoRequest& request) override {
+    ssize_t result;
+    do {
+      result = ::pread(fd, buffer, size, offset);
+    } while (result < 0 && errno == EINTR);
+    request.result = result < 0 ? -errno : result;
+    request.is_done = true;
+  }
+
+  void SubmitWrite(int fd, const void* buffer, size_t size, int64_t offset,
+                   IoRequest& request) override {
+    ssize_t result;
+    do {
+      result = ::pwrite(fd, buffer, size, offset);
+    } while (result < 0 && errno == EINTR);
+    request.result = result < 0 ? -errno : result;
+    request.is_done = true;
+  }
+
+  void Wait(IoRequest&) override {}
+
+  void Poll() override {}
+};
+
+// Talks to the kernel through the raw system calls, so liburing is not
+// required
+class IoUringFileIo : public IAsyncFileIo {
+ public:
+  // Returns nullptr when io_uring or its read and write operations are
+  // unavailable
+  static std::unique_ptr<IoUringFileIo> Create(unsigned entries);
+
+  IoUringFileIo(const IoUringFileIo&) = delete;
+
+  IoUringFileIo& operator=(const IoUringFileIo&) = delete;
+
+  ~IoUringFileIo() override;
+
+  void SubmitRead(int fd, void* buffer, size_t size, int64_t offset,
+                  IoRequest& request) override {
+    Submit(IORING_OP_READ, fd, buffer, size, offset, request);
+  }
+
+  void SubmitWrite(int fd, const void* buffer, size_t size, int64_t offset,
+                   IoRequest& request) override {
+    Submit(IORING_OP_WRITE, fd, buffer, size, offset, request);
+  }
+
+  void Wait(IoRequest& request) override;
+
+  void Poll() override { Reap(); }
+
+ private:
+  IoUringFileIo() = default;
+
+  void Submit(uint8_t opcode, int fd, const void* buffer, size_t size,
+              int64_t offset, IoRequest& request);
+
+  // Marks the completed requests as done
+  void Reap();
+
+  void Enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+ private:
+  int ring_fd_{-1};
+  void* sq_ring_{MAP_FAILED};
+  size_t sq_ring_size_{0};
+  void* cq_ring_{MAP_FAILED};
+  size_t cq_ring_size_{0};
+  io_uring_sqe* sqes_{static_cast<io_uring_sqe*>(MAP_FAILED)};
+  size_t sqes_size_{0};
+
+  unsigned* sq_tail_{nullptr};
+  unsigned* sq_mask_{nullptr};
+  unsigned* sq_array_{nullptr};
+  unsigned sq_entries_{0};
+  unsigned* cq_head_{nullptr};
+  unsigned* cq_tail_{nullptr};
+  unsigned* cq_mask_{nullptr};
+  io_uring_cqe* cqes_{nullptr};
+
+  unsigned in_flight_{0};
+};
+
+std::unique_ptr<IoUringFileIo> IoUringFileIo::Create(unsigned entries) {
+  io_uring_params params{};
+  auto ring_fd = static_cast<int>(
+      ::syscall(__NR_io_uring_setup, std::max(entries, 1u), &params));
+  if (ring_fd < 0) {
+    return nullptr;
+  }
+  auto io = std::unique_ptr<IoUringFileIo>(new IoUringFileIo());
+  io->ring_fd_ = ring_fd;
+  if (!AreOpsSupported(ring_fd, {IORING_OP_READ, IORING_OP_WRITE})) {
+    return nullptr;
+  }
+
+  io->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  io->cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  auto is_single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (is_single_mmap) {
+    io->sq_ring_size_ = io->cq_ring_size_ =
+        std::max(io->sq_ring_size_, io->cq_ring_size_);
+  }
+  io->sq_ring_ = ::mmap(nullptr, io->sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (io->sq_ring_ == MAP_FAILED) {
+    return nullptr;
+  }
+  if (!is_single_mmap) {
+    io->cq_ring_ =
+        ::mmap(nullptr, io->cq_ring_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    if (io->cq_ring_ == MAP_FAILED) {
+      return nullptr;
+    }
+  }
+  io->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  io->sqes_ = static_cast<io_uring_sqe*>(
+      ::mmap(nullptr, io->sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+  if (io->sqes_ == MAP_FAILED) {
+    return nullptr;
+  }
+
+  auto* sq_ring = static_cast<char*>(io->sq_ring_);
+  auto* cq_ring =
+      static_cast<char*>(is_single_mmap ? io->sq_ring_ : io->cq_ring_);
+  io->sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+  io->sq_mask_ =
+      reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+  io->sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+  io->sq_entries_ = params.sq_entries;
+  io->cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+  io->cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+  io->cq_mask_ =
+      reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+  io->cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+  return io;
+}
+
+IoUringFileIo::~IoUringFileIo() {
+  if (sqes_ != MAP_FAILED) {
+    ::munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED) {
+    ::munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    ::munmap(sq_ring_, sq_ring_size_);
+  }
+  ::close(ring_fd_);
+}
+
+void IoUringFileIo::Wait(IoRequest& request) {
+  Reap();
+  while (!request.is_done) {
+    Enter(0, 1, IORING_ENTER_GETEVENTS);
+    Reap();
+  }
+}
+
+void IoUringFileIo::Submit(uint8_t opcode, int fd, const void* buffer,
+                           size_t size, int64_t offset, IoRequest& request) {
+  // The completion queue is twice as large, so it never overflows
+  Reap();
+  while (in_flight_ == sq_entries_) {
+    Enter(0, 1, IORING_ENTER_GETEVENTS);
+    Reap();
+  }
+
+  auto tail = *sq_tail_;
+  auto index = tail & *sq_mask_;
+  auto& sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = opcode;
+  sqe.fd = fd;
+  sqe.addr = reinterpret_cast<uint64_t>(buffer);
+  sqe.len = static_cast<uint32_t>(size);
+  sqe.off = static_cast<uint64_t>(offset);
+  sqe.user_data = reinterpret_cast<uint64_t>(&request);
+  sq_array_[index] = index;
+  request.is_done = false;
+  ++in_flight_;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+  Enter(1, 0, 0);
+}
+
+void IoUringFileIo::Reap() {
+  auto head = *cq_head_;
+  auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const auto& cqe = cqes_[head & *cq_mask_];
+    auto* request = reinterpret_cast<IoRequest*>(cqe.user_data);
+    request->result = cqe.res;
+    request->is_done = true;
+    --in_flight_;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+void IoUringFileIo::Enter(unsigned to_submit, unsigned min_complete,
+                          unsigned flags) {
+  while (true) {
+    auto result = ::syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                            min_complete, flags, nullptr, 0);
+    if (result >= 0) {
+      return;
+    }
+    if (errno == EAGAIN || errno == EBUSY) {
+      // Out of resources until some requests complete
+      Reap();
+      flags |= IORING_ENTER_GETEVENTS;
+      min_complete = std::min(1u, in_flight_);
+    } else if (errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(),
+                              "io_uring_enter failed");
+    }
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<IAsyncFileIo> CreateAsyncFileIo(unsigned queue_depth) {
+  if (auto io = IoUringFileIo::Create(queue_depth)) {
+    return io;
+  }
+  return std::make_unique<PosixFileIo>();
+}
+
+}  // namespace tape_sorter
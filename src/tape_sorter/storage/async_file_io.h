@@ -0,0 +1,53 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace tape_sorter {
+
+struct IoRequest {
+  // Transferred bytes or -errno
+  ssize_t result{0};
+  bool is_done{true};
+};
+
+// Asynchronous positional file I/O, the buffer and the request must stay
+// alive until the request is done
+class IAsyncFileIo {
+ public:
+  virtual void SubmitRead(int fd, void* buffer, size_t size, int64_t offset,
+                          IoRequest& request) = 0;
+
+  virtual void SubmitWrite(int fd, const void* buffer, size_t size,
+                           int64_t offset, IoRequest& request) = 0;
+
+  // Blocks until the request is done
+  virtual void Wait(IoRequest& request) = 0;
+
+  // Marks the requests completed meanwhile as done, without blocking
+  virtual void Poll() = 0;
+
+  virtual ~IAsyncFileIo() = default;
+};
+
+// io_uring with up to queue_depth requests in flight when the kernel
+// provides it, synchronous pread/pwrite otherwise
+std::unique_ptr<IAsyncFileIo> CreateAsyncFileIo(unsigned queue_depth);
+
+}  // namespace tape_sorter
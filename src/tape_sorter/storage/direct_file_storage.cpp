@@ -0,0 +1,292 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "direct_file_storage.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+namespace tape_sorter {
+
+namespace {
+
+constexpr size_t kAlignment = 4096;
+
+int OpenFile(const fs::path& file_path) {
+  auto fd = ::open(file_path.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  if (fd < 0 && errno == EINVAL) {
+    // The file system does not support O_DIRECT
+    fd = ::open(file_path.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  if (fd < 0) {
+    std::stringstream msg_stream;
+    msg_stream << "Failed to open file: " << file_path;
+    throw std::system_error(errno, std::generic_category(), msg_stream.str());
+  }
+  return fd;
+}
+
+int64_t GetFileSize(int fd) {
+  struct stat file_stat;
+  if (::fstat(fd, &file_stat) != 0) {
+    throw std::system_error(errno, std::generic_category(), "fstat failed");
+  }
+  return file_stat.st_size;
+}
+
+}  // namespace
+
+DirectFileStorage::DirectFileStorage(
+    const fs::path& file_path, std::shared_ptr<BufferArena> buffer_arena,
+    size_t block_size, unsigned queue_depth)
+    : buffer_arena_(std::move(buffer_arena)),
+      block_size_(block_size),
+      queue_depth_(queue_depth),
+      blocks_(queue_depth + 1) {
+  if (block_size_ == 0 || block_size_ % kAlignment != 0) {
+    throw std::invalid_argument("Block size must be a multiple of 4096\n");
+  }
+  fd_ = OpenFile(file_path);
+  try {
+    size_ = GetFileSize(fd_);
+    io_ = CreateAsyncFileIo(queue_depth_);
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+}
+
+DirectFileStorage::~DirectFileStorage() {
+  try {
+    Flush();
+  } catch (const std::exception&) {
+  }
+  // Nothing may stay in flight after the buffers are freed
+  for (auto& block : blocks_) {
+    if (block.state == BlockState::kReading ||
+        block.state == BlockState::kWriting) {
+      io_->Wait(block.request);
+    }
+  }
+  ::close(fd_);
+}
+
+std::optional<int> DirectFileStorage::Read(int64_t index) {
+  auto offset = index * static_cast<int64_t>(sizeof(int));
+  if (offset + static_cast<int64_t>(sizeof(int)) > size_) {
+    return std::nullopt;
+  }
+  auto& block = Access(offset / block_size_);
+  int value;
+  std::memcpy(&value, block.buffer.Data() + offset % block_size_,
+              sizeof(value));
+  return value;
+}
+
+void DirectFileStorage::Write(int64_t index, int value) {
+  auto offset = index * static_cast<int64_t>(sizeof(int));
+  auto& block = Access(offset / block_size_);
+  std::memcpy(block.buffer.Data() + offset % block_size_, &value,
+              sizeof(value));
+  block.is_dirty = true;
+  size_ = std::max(size_, offset + static_cast<int64_t>(sizeof(int)));
+}
+
+void DirectFileStorage::Flush() {
+  for (auto& block : blocks_) {
+    if (block.is_dirty && IsIdle(block)) {
+      SubmitWrite(block);
+    }
+  }
+  for (auto& block : blocks_) {
+    Settle(block);
+  }
+  // Whole blocks are written, so the file may be longer than the tape
+  if (::ftruncate(fd_, size_) != 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "ftruncate failed");
+  }
+}
+
+DirectFileStorage::Block& DirectFileStorage::Access(int64_t block_index) {
+  auto* block = Find(block_index);
+  if (block == nullptr) {
+    block = &Acquire();
+    SubmitRead(*block, block_index);
+  }
+  Settle(*block);
+  block->last_access = ++clock_;
+
+  if (block_index != current_block_) {
+    auto direction = block_index > current_block_ ? 1 : -1;
+    // The head has left the block, so it is written behind
+    if (auto* previous = Find(current_block_);
+        previous != nullptr && previous->is_dirty && IsIdle(*previous)) {
+      SubmitWrite(*previous);
+    }
+    current_block_ = block_index;
+    Prefetch(block_index, direction);
+  }
+  return *block;
+}
+
+DirectFileStorage::Block* DirectFileStorage::Find(int64_t block_index) {
+  for (auto& block : blocks_) {
+    if (block.state != BlockState::kEmpty && block.index == block_index) {
+      return &block;
+    }
+  }
+  return nullptr;
+}
+
+DirectFileStorage::Block* DirectFileStorage::FindVictim() {
+  Block* victim = nullptr;
+  for (auto& block : blocks_) {
+    if (block.state == BlockState::kEmpty) {
+      return &block;
+    }
+    if (!IsIdle(block) || block.is_dirty || block.index == current_block_) {
+      continue;
+    }
+    if (victim == nullptr || block.last_access < victim->last_access) {
+      victim = &block;
+    }
+  }
+  return victim;
+}
+
+DirectFileStorage::Block& DirectFileStorage::Acquire() {
+  while (true) {
+    if (auto* victim = FindVictim()) {
+      return *victim;
+    }
+    // Every block is dirty, in flight or under the head: write back the
+    // least recently used one and wait for it
+    Block* oldest = nullptr;
+    for (auto& block : blocks_) {
+      if (block.index == current_block_ && blocks_.size() > 1) {
+        continue;
+      }
+      if (oldest == nullptr || block.last_access < oldest->last_access) {
+        oldest = &block;
+      }
+    }
+    if (oldest->is_dirty && IsIdle(*oldest)) {
+      SubmitWrite(*oldest);
+    }
+    Settle(*oldest);
+    if (oldest->index == current_block_) {
+      return *oldest;
+    }
+  }
+}
+
+void DirectFileStorage::Prefetch(int64_t block_index, int64_t direction) {
+  for (auto i = 1u; i <= queue_depth_; ++i) {
+    auto next_index = block_index + direction * i;
+    if (next_index < 0 ||
+        next_index * static_cast<int64_t>(block_size_) >= size_) {
+      break;
+    }
+    if (Find(next_index) != nullptr) {
+      continue;
+    }
+    auto* block = FindVictim();
+    if (block == nullptr) {
+      break;
+    }
+    SubmitRead(*block, next_index);
+    block->last_access = ++clock_;
+  }
+}
+
+void DirectFileStorage::SubmitRead(Block& block, int64_t block_index) {
+  if (block.buffer.Data() == nullptr) {
+    block.buffer = buffer_arena_->Acquire(block_size_);
+  }
+  block.index = block_index;
+  block.is_dirty = false;
+  auto offset = block_index * static_cast<int64_t>(block_size_);
+  if (offset >= size_) {
+    // Nothing has been written there yet
+    std::memset(block.buffer.Data(), 0, block_size_);
+    block.state = BlockState::kReady;
+    return;
+  }
+  block.state = BlockState::kReading;
+  io_->SubmitRead(fd_, block.buffer.Data(), block_size_, offset,
+                  block.request);
+}
+
+void DirectFileStorage::SubmitWrite(Block& block) {
+  block.state = BlockState::kWriting;
+  block.is_dirty = false;
+  io_->SubmitWrite(fd_, block.buffer.Data(), block_size_,
+                   block.index * static_cast<int64_t>(block_size_),
+                   block.request);
+}
+
+bool DirectFileStorage::IsIdle(Block& block) {
+  if (block.state != BlockState::kReading &&
+      block.state != BlockState::kWriting) {
+    return true;
+  }
+  if (!block.request.is_done) {
+    // Completions are only reaped on demand
+    io_->Poll();
+    if (!block.request.is_done) {
+      return false;
+    }
+  }
+  Complete(block);
+  return true;
+}
+
+void DirectFileStorage::Settle(Block& block) {
+  if (block.state != BlockState::kReading &&
+      block.state != BlockState::kWriting) {
+    return;
+  }
+  io_->Wait(block.request);
+  Complete(block);
+}
+
+void DirectFileStorage::Complete(Block& block) {
+  auto result = block.request.result;
+  auto state = block.state;
+  block.state = BlockState::kReady;
+  if (result < 0) {
+    // The block content is unknown
+    block.state = BlockState::kEmpty;
+    throw std::system_error(static_cast<int>(-result), std::generic_category(),
+                            state == BlockState::kReading
+                                ? "Failed to read the tape file"
+                                : "Failed to write the tape file");
+  }
+  if (state == BlockState::kReading) {
+    // The last block of the file is short
+    std::memset(block.buffer.Data() + result, 0, block_size_ - result);
+  } else if (static_cast<size_t>(result) != block_size_) {
+    block.state = BlockState::kEmpty;
+    throw std::runtime_error("Short write to the tape file\n");
+  }
+}
+
+}  // namespace tape_sorter
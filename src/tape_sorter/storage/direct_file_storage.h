@@ -0,0 +1,111 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "async_file_io.h"
+#include "tape_sorter/buffer_arena.h"
+#include "file_tape_storage_interface.h"
+
+namespace tape_sorter {
+
+namespace fs = std::filesystem;
+
+// Keeps a few aligned blocks of the file in memory and bypasses the page
+// cache with O_DIRECT when the file system supports it. Blocks ahead of the
+// head are read in advance and blocks the head has left are written behind,
+// so up to queue_depth requests are in flight. The file must not be changed
+// by others while the storage is alive.
+class DirectFileStorage : public IFileTapeStorage {
+ public:
+  static constexpr size_t kDefaultBlockSize = 64 << 10;
+  static constexpr unsigned kDefaultQueueDepth = 4;
+
+  // block_size must be a multiple of 4096, the blocks are taken from the
+  // arena
+  DirectFileStorage(const fs::path& file_path,
+                    std::shared_ptr<BufferArena> buffer_arena,
+                    size_t block_size = kDefaultBlockSize,
+                    unsigned queue_depth = kDefaultQueueDepth);
+
+  DirectFileStorage(const DirectFileStorage&) = delete;
+
+  DirectFileStorage& operator=(const DirectFileStorage&) = delete;
+
+  ~DirectFileStorage() override;
+
+  std::optional<int> Read(int64_t index) override;
+
+  void Write(int64_t index, int value) override;
+
+  void Flush() override;
+
+ private:
+  enum class BlockState { kEmpty, kReady, kReading, kWriting };
+
+  struct Block {
+    BufferArena::Buffer buffer;
+    int64_t index{-1};
+    BlockState state{BlockState::kEmpty};
+    bool is_dirty{false};
+    uint64_t last_access{0};
+    IoRequest request;
+  };
+
+ private:
+  // Returns the block resident and not in flight
+  Block& Access(int64_t block_index);
+
+  Block* Find(int64_t block_index);
+
+  // Returns the least recently used block that can be reused without
+  // waiting, or nullptr
+  Block* FindVictim();
+
+  // Returns a block that can be reused, waiting for the I/O if needed
+  Block& Acquire();
+
+  void Prefetch(int64_t block_index, int64_t direction);
+
+  void SubmitRead(Block& block, int64_t block_index);
+
+  void SubmitWrite(Block& block);
+
+  // Returns false while the block is in flight
+  bool IsIdle(Block& block);
+
+  // Waits for the block I/O and checks its result
+  void Settle(Block& block);
+
+  void Complete(Block& block);
+
+ private:
+  int fd_;
+  // Outlives the blocks
+  std::shared_ptr<BufferArena> buffer_arena_;
+  size_t block_size_;
+  // Bytes
+  int64_t size_;
+  unsigned queue_depth_;
+  std::vector<Block> blocks_;
+  int64_t current_block_{-1};
+  uint64_t clock_{0};
+  std::unique_ptr<IAsyncFileIo> io_;
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,36 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace tape_sorter {
+
+// Values of a file tape addressed by their index
+class IFileTapeStorage {
+ public:
+  // Returns nullopt past the end of the file
+  virtual std::optional<int> Read(int64_t index) = 0;
+
+  virtual void Write(int64_t index, int value) = 0;
+
+  // Makes the written values visible to other readers of the file
+  virtual void Flush() = 0;
+
+  virtual ~IFileTapeStorage() = default;
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,216 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "framed_file_storage.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace tape_sorter {
+
+std::unique_ptr<IFileTapeStorage> FramedFileStorage::Open(
+    std::unique_ptr<IFileTapeStorage> storage, FileTapeFormat format) {
+  EncodedTapeFileHeader values;
+  size_t values_number = 0;
+  while (values_number != values.size()) {
+    auto value = storage->Read(static_cast<int64_t>(values_number));
+    if (!value) {
+      break;
+    }
+    values[values_number++] = value.value();
+  }
+  if (values_number == 0 && format == FileTapeFormat::kFramed) {
+    auto framed_storage = std::make_unique<FramedFileStorage>(
+        std::move(storage), TapeFileHeader{}, std::vector<uint32_t>{});
+    // An empty tape gets its header as well
+    framed_storage->is_changed_ = true;
+    return framed_storage;
+  }
+  // Raw files shorter than a header are not framed
+  std::optional<TapeFileHeader> header;
+  if (values_number == values.size()) {
+    header = DecodeTapeFileHeader(values);
+  }
+  if (!header) {
+    return storage;
+  }
+
+  auto tape_values_number =
+      static_cast<int64_t>(header->metadata.values_number);
+  auto blocks_number =
+      (tape_values_number + header->block_values - 1) / header->block_values;
+  std::vector<uint32_t> block_checksums;
+  block_checksums.reserve(blocks_number);
+  for (int64_t i = 0; i != blocks_number; ++i) {
+    auto checksum = storage->Read(GetStorageIndex(tape_values_number + i));
+    if (!checksum) {
+      throw std::runtime_error("Tape file is truncated\n");
+    }
+    block_checksums.push_back(static_cast<uint32_t>(checksum.value()));
+  }
+  return std::make_unique<FramedFileStorage>(std::move(storage), *header,
+                                             std::move(block_checksums));
+}
+
+FramedFileStorage::FramedFileStorage(std::unique_ptr<IFileTapeStorage> storage,
+                                     const TapeFileHeader& header,
+                                     std::vector<uint32_t> block_checksums)
+    : storage_(std::move(storage)),
+      header_(header),
+      block_checksums_(std::move(block_checksums)) {
+  const auto& metadata = header_.metadata;
+  // Equal values are in both orders
+  is_ascending_ = metadata.sort_order == SortOrder::kAscending ||
+                  metadata.min == metadata.max;
+  is_descending_ = metadata.sort_order == SortOrder::kDescending ||
+                   metadata.min == metadata.max;
+  if (metadata.values_number != 0) {
+    auto last_value = storage_->Read(
+        GetStorageIndex(static_cast<int64_t>(metadata.values_number) - 1));
+    if (!last_value) {
+      throw std::runtime_error("Tape file is truncated\n");
+    }
+    last_value_ = last_value.value();
+  }
+}
+
+FramedFileStorage::~FramedFileStorage() {
+  try {
+    WriteFrame();
+  } catch (...) {
+  }
+}
+
+std::optional<int> FramedFileStorage::Read(int64_t index) {
+  if (static_cast<uint64_t>(index) >= header_.metadata.values_number) {
+    return std::nullopt;
+  }
+  return storage_->Read(GetStorageIndex(index));
+}
+
+void FramedFileStorage::Write(int64_t index, int value) {
+  storage_->Write(GetStorageIndex(index), value);
+  is_changed_ = true;
+  auto& values_number = header_.metadata.values_number;
+  if (static_cast<uint64_t>(index) < values_number) {
+    is_overwritten_ = true;
+  } else if (is_overwritten_) {
+    ++values_number;
+  } else {
+    Append(value);
+  }
+}
+
+void FramedFileStorage::Flush() {
+  WriteFrame();
+  storage_->Flush();
+}
+
+std::optional<TapeMetadata> FramedFileStorage::GetMetadata() const {
+  if (is_overwritten_) {
+    return std::nullopt;
+  }
+  return header_.metadata;
+}
+
+bool FramedFileStorage::VerifyChecksums() {
+  Flush();
+  auto values_number = static_cast<int64_t>(header_.metadata.values_number);
+  int64_t block_values = header_.block_values;
+  for (size_t block = 0; block != block_checksums_.size(); ++block) {
+    auto begin = static_cast<int64_t>(block) * block_values;
+    auto end = std::min(begin + block_values, values_number);
+    uint32_t checksum = 0;
+    for (auto i = begin; i != end; ++i) {
+      auto value = storage_->Read(GetStorageIndex(i));
+      if (!value) {
+        return false;
+      }
+      checksum = Crc32(checksum, &value.value(), sizeof(int));
+    }
+    auto stored_checksum = storage_->Read(
+        GetStorageIndex(values_number + static_cast<int64_t>(block)));
+    if (!stored_checksum ||
+        static_cast<uint32_t>(stored_checksum.value()) != checksum) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void FramedFileStorage::Append(int value) {
+  auto& metadata = header_.metadata;
+  if (metadata.values_number == 0) {
+    metadata.min = value;
+    metadata.max = value;
+  } else {
+    metadata.min = std::min(metadata.min, value);
+    metadata.max = std::max(metadata.max, value);
+    is_ascending_ = is_ascending_ && last_value_ <= value;
+    is_descending_ = is_descending_ && value <= last_value_;
+  }
+  metadata.sort_order = is_ascending_    ? SortOrder::kAscending
+                        : is_descending_ ? SortOrder::kDescending
+                                         : SortOrder::kNone;
+  last_value_ = value;
+  auto block = metadata.values_number / header_.block_values;
+  if (block == block_checksums_.size()) {
+    block_checksums_.push_back(0);
+  }
+  block_checksums_[block] =
+      Crc32(block_checksums_[block], &value, sizeof(value));
+  ++metadata.values_number;
+}
+
+void FramedFileStorage::Scan() {
+  auto values_number = static_cast<int64_t>(header_.metadata.values_number);
+  header_.metadata = {};
+  is_ascending_ = true;
+  is_descending_ = true;
+  block_checksums_.clear();
+  is_overwritten_ = false;
+  for (int64_t i = 0; i != values_number; ++i) {
+    auto value = storage_->Read(GetStorageIndex(i));
+    if (!value) {
+      throw std::runtime_error("Tape file is truncated\n");
+    }
+    Append(value.value());
+  }
+}
+
+void FramedFileStorage::WriteFrame() {
+  if (!is_changed_) {
+    return;
+  }
+  if (is_overwritten_) {
+    Scan();
+  }
+  // The header goes last, so it describes a complete file
+  auto values_number = static_cast<int64_t>(header_.metadata.values_number);
+  for (size_t block = 0; block != block_checksums_.size(); ++block) {
+    storage_->Write(GetStorageIndex(values_number + static_cast<int64_t>(block)),
+                    static_cast<int>(block_checksums_[block]));
+  }
+  auto header = EncodeTapeFileHeader(header_);
+  for (size_t i = 0; i != header.size(); ++i) {
+    storage_->Write(static_cast<int64_t>(i), header[i]);
+  }
+  is_changed_ = false;
+}
+
+int64_t FramedFileStorage::GetStorageIndex(int64_t index) {
+  return index + static_cast<int64_t>(TapeFileHeader::kValuesNumber);
+}
+
+}  // namespace tape_sorter
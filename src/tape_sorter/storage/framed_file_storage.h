@@ -0,0 +1,83 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "file_tape_storage_interface.h"
+#include "tape_file_header.h"
+#include "tape_sorter/file_tape_format.h"
+
+namespace tape_sorter {
+
+// Keeps the values of a framed tape file between its header and the
+// checksums of their blocks, see FileTapeFormat::kFramed. The metadata and
+// the checksums are updated as values are appended and recomputed from the
+// file once one is overwritten. The header and the checksums are written by
+// Flush and on destruction.
+class FramedFileStorage : public IFileTapeStorage {
+ public:
+  // Wraps the storage when its file is framed, or when it is empty and the
+  // format is kFramed. Throws std::runtime_error when the frame is corrupted.
+  static std::unique_ptr<IFileTapeStorage> Open(
+      std::unique_ptr<IFileTapeStorage> storage, FileTapeFormat format);
+
+  FramedFileStorage(std::unique_ptr<IFileTapeStorage> storage,
+                    const TapeFileHeader& header,
+                    std::vector<uint32_t> block_checksums);
+
+  // An error of writing the frame is dropped, Flush reports it
+  ~FramedFileStorage() override;
+
+  std::optional<int> Read(int64_t index) override;
+
+  void Write(int64_t index, int value) override;
+
+  void Flush() override;
+
+  // nullopt once values were overwritten, until the next flush
+  std::optional<TapeMetadata> GetMetadata() const;
+
+  // Whether the values match the checksums in the file, flushes first
+  bool VerifyChecksums();
+
+ private:
+  void Append(int value);
+
+  // Recomputes the metadata and the checksums from the values of the file
+  void Scan();
+
+  // Writes the header and the checksums if the values changed
+  void WriteFrame();
+
+  static int64_t GetStorageIndex(int64_t index);
+
+ private:
+  std::unique_ptr<IFileTapeStorage> storage_;
+  TapeFileHeader header_;
+  // Whether the values appended so far are in the order
+  bool is_ascending_{true};
+  bool is_descending_{true};
+  int last_value_{0};
+  std::vector<uint32_t> block_checksums_;
+  // The frame in the file is outdated
+  bool is_changed_{false};
+  // The metadata and the checksums are outdated
+  bool is_overwritten_{false};
+};
+
+}  // namespace tape_sorter
@@ -0,0 +1,52 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "stream_file_storage.h"
+
+namespace tape_sorter {
+
+StreamFileStorage::StreamFileStorage(const fs::path& file_path) {
+  if (!fs::exists(file_path)) {
+    std::ofstream{file_path};
+  }
+  // Every operation seeks, so a buffer would be refilled on each read and
+  // flushed on each write. Without it an idle tape keeps no memory
+  stream_.rdbuf()->pubsetbuf(nullptr, 0);
+  stream_.open(file_path,
+               std::fstream::in | std::fstream::out | std::fstream::binary);
+}
+
+std::optional<int> StreamFileStorage::Read(int64_t index) {
+  // Reset state
+  stream_.clear();
+  stream_.seekg(index * std::streamoff(sizeof(int)));
+  int value;
+  if (!stream_.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+    stream_.clear();
+    return std::nullopt;
+  }
+  return value;
+}
+
+void StreamFileStorage::Write(int64_t index, int value) {
+  stream_.clear();
+  stream_.seekp(index * std::streamoff(sizeof(int)));
+  stream_.write(reinterpret_cast<char*>(&value), sizeof(value));
+  // Every value is visible to other readers as soon as it is written
+  stream_.flush();
+}
+
+void StreamFileStorage::Flush() { stream_.flush(); }
+
+}  // namespace tape_sorter
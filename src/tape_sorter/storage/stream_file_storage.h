@@ -0,0 +1,40 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+
+#include "file_tape_storage_interface.h"
+
+namespace tape_sorter {
+
+namespace fs = std::filesystem;
+
+class StreamFileStorage : public IFileTapeStorage {
+ public:
+  StreamFileStorage(const fs::path& file_path);
+
+  std::optional<int> Read(int64_t index) override;
+
+  void Write(int64_t index, int value) override;
+
+  void Flush() override;
+
+ private:
+  std::fstream stream_;
+};
+
+}  // namespace tape_sorter
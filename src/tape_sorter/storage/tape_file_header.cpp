@@ -0,0 +1,138 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_file_header.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace tape_sorter {
+
+namespace {
+
+// Not a likely start of raw values: the first byte is not ASCII and the line
+// endings catch text mode conversions
+constexpr std::array<char, 8> kMagic = {'\x89', 'T', 'A', 'P',
+                                        'E',    '\r', '\n', '\x1a'};
+
+enum class ElementType : uint8_t { kInt32 = 1 };
+
+// Byte offsets of the fields
+constexpr size_t kVersionOffset = 8;
+constexpr size_t kElementTypeOffset = 10;
+constexpr size_t kElementSizeOffset = 11;
+constexpr size_t kBlockValuesOffset = 12;
+constexpr size_t kValuesNumberOffset = 16;
+constexpr size_t kMinOffset = 24;
+constexpr size_t kMaxOffset = 28;
+constexpr size_t kIsSortedOffset = 32;
+constexpr size_t kSortOrderOffset = 33;
+constexpr size_t kChecksumOffset = 60;
+constexpr size_t kHeaderSize = TapeFileHeader::kValuesNumber * sizeof(int);
+static_assert(kChecksumOffset + sizeof(uint32_t) == kHeaderSize);
+
+template <typename T>
+void Put(char* bytes, size_t offset, T value) {
+  std::memcpy(bytes + offset, &value, sizeof(value));
+}
+
+template <typename T>
+T Get(const char* bytes, size_t offset) {
+  T value;
+  std::memcpy(&value, bytes + offset, sizeof(value));
+  return value;
+}
+
+std::array<uint32_t, 256> MakeCrc32Table() {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i != table.size(); ++i) {
+    auto value = i;
+    for (int bit = 0; bit != 8; ++bit) {
+      value = (value & 1) != 0 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+    }
+    table[i] = value;
+  }
+  return table;
+}
+
+}  // namespace
+
+EncodedTapeFileHeader EncodeTapeFileHeader(const TapeFileHeader& header) {
+  char bytes[kHeaderSize] = {};
+  std::memcpy(bytes, kMagic.data(), kMagic.size());
+  Put(bytes, kVersionOffset, TapeFileHeader::kVersion);
+  Put(bytes, kElementTypeOffset, ElementType::kInt32);
+  Put(bytes, kElementSizeOffset, static_cast<uint8_t>(sizeof(int)));
+  Put(bytes, kBlockValuesOffset, header.block_values);
+  const auto& metadata = header.metadata;
+  Put(bytes, kValuesNumberOffset, metadata.values_number);
+  Put(bytes, kMinOffset, metadata.min);
+  Put(bytes, kMaxOffset, metadata.max);
+  Put(bytes, kIsSortedOffset,
+      static_cast<uint8_t>(metadata.sort_order != SortOrder::kNone));
+  Put(bytes, kSortOrderOffset, metadata.sort_order);
+  Put(bytes, kChecksumOffset, Crc32(0, bytes, kChecksumOffset));
+
+  EncodedTapeFileHeader values;
+  std::memcpy(values.data(), bytes, kHeaderSize);
+  return values;
+}
+
+std::optional<TapeFileHeader> DecodeTapeFileHeader(
+    const EncodedTapeFileHeader& values) {
+  char bytes[kHeaderSize];
+  std::memcpy(bytes, values.data(), kHeaderSize);
+  if (std::memcmp(bytes, kMagic.data(), kMagic.size()) != 0) {
+    return std::nullopt;
+  }
+  if (Get<uint32_t>(bytes, kChecksumOffset) !=
+      Crc32(0, bytes, kChecksumOffset)) {
+    throw std::runtime_error("Tape file header is corrupted\n");
+  }
+  if (Get<uint16_t>(bytes, kVersionOffset) != TapeFileHeader::kVersion) {
+    throw std::runtime_error("Unsupported tape file version\n");
+  }
+  if (Get<ElementType>(bytes, kElementTypeOffset) != ElementType::kInt32 ||
+      Get<uint8_t>(bytes, kElementSizeOffset) != sizeof(int)) {
+    throw std::runtime_error("Unsupported tape file element type\n");
+  }
+  TapeFileHeader header;
+  header.block_values = Get<uint32_t>(bytes, kBlockValuesOffset);
+  if (header.block_values == 0) {
+    throw std::runtime_error("Tape file header is corrupted\n");
+  }
+  auto& metadata = header.metadata;
+  metadata.values_number = Get<uint64_t>(bytes, kValuesNumberOffset);
+  metadata.min = Get<int>(bytes, kMinOffset);
+  metadata.max = Get<int>(bytes, kMaxOffset);
+  metadata.sort_order = Get<SortOrder>(bytes, kSortOrderOffset);
+  if (metadata.sort_order > SortOrder::kDescending ||
+      Get<uint8_t>(bytes, kIsSortedOffset) !=
+          (metadata.sort_order != SortOrder::kNone)) {
+    throw std::runtime_error("Tape file header is corrupted\n");
+  }
+  return header;
+}
+
+uint32_t Crc32(uint32_t crc, const void* data, size_t size) {
+  static const auto kTable = MakeCrc32Table();
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  crc = ~crc;
+  for (size_t i = 0; i != size; ++i) {
+    crc = kTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+}  // namespace tape_sorter
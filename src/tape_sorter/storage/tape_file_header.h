@@ -0,0 +1,51 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "tape_sorter/tape_metadata.h"
+
+namespace tape_sorter {
+
+// The header of a framed tape file, see FileTapeFormat::kFramed
+struct TapeFileHeader {
+  static constexpr uint16_t kVersion = 1;
+  // Values taken by the header in the file
+  static constexpr size_t kValuesNumber = 16;
+  static constexpr uint32_t kDefaultBlockValues = 4096;
+
+  TapeMetadata metadata;
+  // Values covered by each checksum
+  uint32_t block_values{kDefaultBlockValues};
+};
+
+using EncodedTapeFileHeader = std::array<int, TapeFileHeader::kValuesNumber>;
+
+EncodedTapeFileHeader EncodeTapeFileHeader(const TapeFileHeader& header);
+
+// Returns nullopt when the values do not start with the magic of the format.
+// Throws std::runtime_error for a corrupted header or one of an unsupported
+// version or element type.
+std::optional<TapeFileHeader> DecodeTapeFileHeader(
+    const EncodedTapeFileHeader& values);
+
+// Continues the CRC-32 crc of the preceding data, 0 for none
+uint32_t Crc32(uint32_t crc, const void* data, size_t size);
+
+}  // namespace tape_sorter
@@ -0,0 +1,260 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_sorter/stream_tape.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+
+namespace tape_sorter {
+
+namespace {
+
+// Enough for any int in text form with its separator
+constexpr size_t kMinBufferSize = 64;
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+int OpenFile(const fs::path& file_path, int flags) {
+  auto fd = ::open(file_path.c_str(), flags, 0644);
+  if (fd < 0) {
+    std::stringstream msg_stream;
+    msg_stream << "Failed to open file: " << file_path;
+    throw std::system_error(errno, std::generic_category(), msg_stream.str());
+  }
+  return fd;
+}
+
+}  // namespace
+
+InputStreamTape::InputStreamTape(int fd, StreamFormat format,
+                                 size_t buffer_size)
+    : fd_(fd),
+      owns_fd_(false),
+      format_(format),
+      buffer_(std::max(buffer_size, kMinBufferSize)) {}
+
+InputStreamTape::InputStreamTape(const fs::path& file_path,
+                                 StreamFormat format, size_t buffer_size)
+    : InputStreamTape(OpenFile(file_path, O_RDONLY), format, buffer_size) {
+  owns_fd_ = true;
+}
+
+InputStreamTape::~InputStreamTape() {
+  if (owns_fd_) {
+    ::close(fd_);
+  }
+}
+
+std::optional<int> InputStreamTape::Read() { return Peek(); }
+
+void InputStreamTape::Write(int) {
+  throw std::logic_error("Writing to an input stream tape is prohibited\n");
+}
+
+bool InputStreamTape::MoveForward() {
+  if (!Peek()) {
+    return false;
+  }
+  current_value_.reset();
+  return true;
+}
+
+bool InputStreamTape::MoveBackward() { return false; }
+
+void InputStreamTape::Rewind() {
+  throw std::logic_error("Rewinding an input stream tape is not supported\n");
+}
+
+std::optional<int> InputStreamTape::ReadForward() {
+  auto value = Peek();
+  current_value_.reset();
+  return value;
+}
+
+std::optional<int> InputStreamTape::Peek() {
+  if (!current_value_) {
+    current_value_ =
+        format_ == StreamFormat::kBinary ? ParseBinary() : ParseText();
+  }
+  return current_value_;
+}
+
+std::optional<int> InputStreamTape::ParseBinary() {
+  while (end_ - begin_ < sizeof(int)) {
+    if (!Refill()) {
+      if (begin_ != end_) {
+        throw std::runtime_error("Truncated value at the end of the stream\n");
+      }
+      return std::nullopt;
+    }
+  }
+  int value;
+  std::memcpy(&value, buffer_.data() + begin_, sizeof(value));
+  begin_ += sizeof(value);
+  return value;
+}
+
+std::optional<int> InputStreamTape::ParseText() {
+  while (true) {
+    auto first = std::find_if_not(buffer_.data() + begin_,
+                                  buffer_.data() + end_, IsSpace);
+    begin_ = first - buffer_.data();
+    if (begin_ == end_) {
+      if (!Refill()) {
+        return std::nullopt;
+      }
+      continue;
+    }
+    auto last = std::find_if(first, buffer_.data() + end_, IsSpace);
+    // The token may continue in the data not read yet
+    if (last == buffer_.data() + end_ && Refill()) {
+      continue;
+    }
+    // Refill may have moved the data
+    first = buffer_.data() + begin_;
+    last = std::find_if(first, buffer_.data() + end_, IsSpace);
+
+    int value;
+    auto [ptr, error] = std::from_chars(first, last, value);
+    if (error != std::errc{} || ptr != last) {
+      std::stringstream msg_stream;
+      msg_stream << "Cannot convert string to int: '"
+                 << std::string_view(first, last - first) << "'\n";
+      throw std::invalid_argument{msg_stream.str()};
+    }
+    begin_ = last - buffer_.data();
+    return value;
+  }
+}
+
+bool InputStreamTape::Refill() {
+  if (is_eof_) {
+    return false;
+  }
+  // Keep the unparsed bytes, a token longer than the buffer grows it
+  std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+  end_ -= begin_;
+  begin_ = 0;
+  if (end_ == buffer_.size()) {
+    buffer_.resize(2 * buffer_.size());
+  }
+
+  ssize_t bytes_read;
+  do {
+    bytes_read = ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+  } while (bytes_read < 0 && errno == EINTR);
+  if (bytes_read < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "Failed to read the input stream");
+  }
+  if (bytes_read == 0) {
+    is_eof_ = true;
+    return false;
+  }
+  end_ += bytes_read;
+  return true;
+}
+
+OutputStreamTape::OutputStreamTape(int fd, StreamFormat format,
+                                   size_t buffer_size)
+    : fd_(fd),
+      owns_fd_(false),
+      format_(format),
+      buffer_(std::max(buffer_size, kMinBufferSize)) {}
+
+OutputStreamTape::OutputStreamTape(const fs::path& file_path,
+                                   StreamFormat format, size_t buffer_size)
+    : OutputStreamTape(OpenFile(file_path, O_WRONLY | O_CREAT | O_TRUNC),
+                       format, buffer_size) {
+  owns_fd_ = true;
+}
+
+OutputStreamTape::~OutputStreamTape() {
+  try {
+    Flush();
+  } catch (const std::exception&) {
+  }
+  if (owns_fd_) {
+    ::close(fd_);
+  }
+}
+
+std::optional<int> OutputStreamTape::Read() { return std::nullopt; }
+
+void OutputStreamTape::Write(int value) { pending_value_ = value; }
+
+bool OutputStreamTape::MoveForward() {
+  if (!pending_value_) {
+    return false;
+  }
+  Append(pending_value_.value());
+  pending_value_.reset();
+  return true;
+}
+
+bool OutputStreamTape::MoveBackward() { return false; }
+
+void OutputStreamTape::Rewind() {
+  throw std::logic_error("Rewinding an output stream tape is not supported\n");
+}
+
+void OutputStreamTape::WriteForward(int value) {
+  pending_value_.reset();
+  Append(value);
+}
+
+void OutputStreamTape::Flush() {
+  size_t written = 0;
+  while (written != size_) {
+    auto bytes_written =
+        ::write(fd_, buffer_.data() + written, size_ - written);
+    if (bytes_written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "Failed to write the output stream");
+    }
+    written += bytes_written;
+  }
+  size_ = 0;
+}
+
+void OutputStreamTape::Append(int value) {
+  if (buffer_.size() - size_ < kMinBufferSize) {
+    Flush();
+  }
+  if (format_ == StreamFormat::kBinary) {
+    std::memcpy(buffer_.data() + size_, &value, sizeof(value));
+    size_ += sizeof(value);
+  } else {
+    auto result = std::to_chars(buffer_.data() + size_,
+                                buffer_.data() + buffer_.size(), value);
+    *result.ptr = '\n';
+    size_ = result.ptr + 1 - buffer_.data();
+  }
+}
+
+}  // namespace tape_sorter
@@ -0,0 +1,164 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_sorter/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+
+namespace tape_sorter {
+
+namespace {
+
+// Pool and queue of the current thread, if it belongs to a pool
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads_number) : queues_(threads_number) {
+  if (threads_number == 0) {
+    throw std::invalid_argument("Thread pool needs a thread at least\n");
+  }
+  threads_.reserve(threads_number);
+  for (size_t i = 0; i != threads_number; ++i) {
+    threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(sleep_mutex_);
+    is_stopping_ = true;
+  }
+  task_queued_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  auto& queue = queues_[current_pool == this ? current_queue
+                                             : next_queue_++ % queues_.size()];
+  ++queued_tasks_number_;
+  {
+    std::lock_guard lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  // A thread going to sleep counts itself before it checks the queued tasks
+  // under the sleep lock, so either it sees the task or it is notified
+  if (sleeping_threads_number_ != 0) {
+    std::lock_guard lock(sleep_mutex_);
+    task_queued_.notify_one();
+  }
+}
+
+void ThreadPool::ParallelFor(size_t tasks_number,
+                             const std::function<void(size_t)>& task) {
+  struct Batch {
+    std::atomic<size_t> next_task{0};
+    size_t done_tasks_number{0};
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable all_done;
+  };
+  auto batch = std::make_shared<Batch>();
+  // Helpers starting after every call is taken return at once, so the task
+  // is not used after the batch is done
+  auto run = [batch, tasks_number, &task] {
+    for (auto i = batch->next_task++; i < tasks_number;
+         i = batch->next_task++) {
+      std::exception_ptr error;
+      try {
+        task(i);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard lock(batch->mutex);
+      if (error && !batch->error) {
+        batch->error = error;
+      }
+      if (++batch->done_tasks_number == tasks_number) {
+        batch->all_done.notify_all();
+      }
+    }
+  };
+
+  auto helpers_number = std::min(tasks_number, threads_.size() + 1);
+  for (size_t i = 1; i < helpers_number; ++i) {
+    Submit(run);
+  }
+  run();
+  std::unique_lock lock(batch->mutex);
+  batch->all_done.wait(lock, [&batch, tasks_number] {
+    return batch->done_tasks_number == tasks_number;
+  });
+  if (batch->error) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+size_t ThreadPool::GetThreadsNumber() const { return threads_.size(); }
+
+void ThreadPool::WorkerLoop(size_t index) {
+  current_pool = this;
+  current_queue = index;
+  std::function<void()> task;
+  while (TakeTask(index, task)) {
+    task();
+    task = nullptr;
+  }
+}
+
+bool ThreadPool::TakeTask(size_t index, std::function<void()>& task) {
+  while (!TryTakeTask(index, task)) {
+    std::unique_lock lock(sleep_mutex_);
+    ++sleeping_threads_number_;
+    task_queued_.wait(
+        lock, [this] { return queued_tasks_number_ != 0 || is_stopping_; });
+    --sleeping_threads_number_;
+    if (queued_tasks_number_ == 0) {
+      return false;
+    }
+  }
+  --queued_tasks_number_;
+  return true;
+}
+
+bool ThreadPool::TryTakeTask(size_t index, std::function<void()>& task) {
+  {
+    auto& queue = queues_[index];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i != queues_.size(); ++i) {
+    auto& queue = queues_[(index + i) % queues_.size()];
+    std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace tape_sorter
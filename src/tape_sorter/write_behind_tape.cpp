@@ -0,0 +1,135 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include "tape_sorter/write_behind_tape.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace tape_sorter {
+
+WriteBehindTape::WriteBehindTape(ITape& tape, size_t buffer_size,
+                                 std::shared_ptr<BufferArena> arena)
+    : tape_(tape),
+      buffer_(std::max<size_t>(buffer_size, 1), std::move(arena)),
+      writer_(&WriteBehindTape::WriterLoop, this) {}
+
+WriteBehindTape::~WriteBehindTape() {
+  is_stopping_.store(true, std::memory_order_release);
+  writer_.join();
+}
+
+std::optional<int> WriteBehindTape::Read() {
+  Flush();
+  return tape_.Read();
+}
+
+void WriteBehindTape::Write(int value) {
+  Flush();
+  tape_.Write(value);
+}
+
+bool WriteBehindTape::MoveForward() {
+  Flush();
+  return tape_.MoveForward();
+}
+
+bool WriteBehindTape::MoveBackward() {
+  Flush();
+  return tape_.MoveBackward();
+}
+
+void WriteBehindTape::Rewind() {
+  Flush();
+  tape_.Rewind();
+}
+
+std::optional<int> WriteBehindTape::ReadForward() {
+  Flush();
+  return tape_.ReadForward();
+}
+
+std::optional<int> WriteBehindTape::ReadBackward() {
+  Flush();
+  return tape_.ReadBackward();
+}
+
+void WriteBehindTape::WriteForward(int value) {
+  size_t idle_rounds = 0;
+  while (!buffer_.TryPush(value)) {
+    RethrowError();
+    Wait(idle_rounds);
+  }
+  ++pushed_values_number_;
+}
+
+void WriteBehindTape::Flush() {
+  size_t idle_rounds = 0;
+  while (written_values_number_.load(std::memory_order_acquire) !=
+         pushed_values_number_) {
+    RethrowError();
+    Wait(idle_rounds);
+  }
+  RethrowError();
+}
+
+size_t WriteBehindTape::GetMemoryUsage(size_t buffer_size) {
+  return SpscRingBuffer<int>::GetMemoryUsage(std::max<size_t>(buffer_size, 1));
+}
+
+void WriteBehindTape::WriterLoop() {
+  int batch[kBatchSize];
+  size_t idle_rounds = 0;
+  while (true) {
+    // Read before the buffer, so the values pushed before the stop are seen
+    auto is_stopping = is_stopping_.load(std::memory_order_acquire);
+    auto values_number = buffer_.TryPop(batch, kBatchSize);
+    if (values_number == 0) {
+      if (is_stopping) {
+        return;
+      }
+      Wait(idle_rounds);
+      continue;
+    }
+    idle_rounds = 0;
+    try {
+      for (size_t i = 0; i != values_number; ++i) {
+        tape_.WriteForward(batch[i]);
+      }
+    } catch (...) {
+      error_ = std::current_exception();
+      has_failed_.store(true, std::memory_order_release);
+      return;
+    }
+    written_values_number_.fetch_add(values_number,
+                                     std::memory_order_release);
+  }
+}
+
+void WriteBehindTape::RethrowError() const {
+  if (has_failed_.load(std::memory_order_acquire)) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void WriteBehindTape::Wait(size_t& idle_rounds) {
+  constexpr size_t kYieldRounds = 64;
+  if (idle_rounds++ < kYieldRounds) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds{50});
+  }
+}
+
+}  // namespace tape_sorter
@@ -0,0 +1,67 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/file_tape.h>
+
+// Tapes created in a directory of the test, removed with it
+class FileTapesTest : public ::testing::Test {
+ protected:
+  explicit FileTapesTest(std::string temp_directory)
+      : temp_directory_(std::move(temp_directory)) {}
+
+  void SetUp() override {
+    std::filesystem::create_directory(GetTempDirectory());
+  }
+
+  void TearDown() override {
+    tapes_.clear();
+    std::filesystem::remove_all(GetTempDirectory());
+  }
+
+  std::filesystem::path GetTempDirectory() const {
+    return std::filesystem::current_path() / temp_directory_;
+  }
+
+  // Creates a tape holding the values with its head on the first of them
+  tape_sorter::FileTape& CreateTape(const std::vector<int>& values) {
+    auto path = GetTempDirectory() / std::to_string(tapes_.size());
+    tapes_.push_back(std::make_unique<tape_sorter::FileTape>(path));
+    auto& tape = *tapes_.back();
+    for (auto value : values) {
+      tape.WriteForward(value);
+    }
+    tape.Rewind();
+    return tape;
+  }
+
+  static std::vector<int> ReadAll(tape_sorter::FileTape& tape) {
+    tape.Rewind();
+    std::vector<int> values;
+    while (auto value = tape.ReadForward()) {
+      values.push_back(value.value());
+    }
+    return values;
+  }
+
+ private:
+  std::string temp_directory_;
+  std::vector<std::unique_ptr<tape_sorter::FileTape>> tapes_;
+};
@@ -0,0 +1,90 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/buffer_arena.h>
+
+namespace ts = tape_sorter;
+
+TEST(BufferArena, Aligned) {
+  ts::BufferArena arena;
+  auto buffer = arena.Acquire(100);
+  ASSERT_EQ(buffer.Size(), 100);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(buffer.Data()) % 4096, 0);
+  // the memory is usable up to its size
+  buffer.Data()[99] = 1;
+}
+
+TEST(BufferArena, Empty) {
+  ts::BufferArena arena;
+  auto buffer = arena.Acquire(0);
+  ASSERT_EQ(buffer.Data(), nullptr);
+  ASSERT_EQ(arena.GetMapsNumber(), 0);
+}
+
+TEST(BufferArena, ReusesReleased) {
+  ts::BufferArena arena;
+  auto* data = arena.Acquire(64 << 10).Data();
+  for (auto i = 0; i != 10; ++i) {
+    auto buffer = arena.Acquire(64 << 10);
+    ASSERT_EQ(buffer.Data(), data);
+  }
+  // a somewhat smaller one fits in the released buffer as well
+  ASSERT_EQ(arena.Acquire(40 << 10).Data(), data);
+  ASSERT_EQ(arena.GetMapsNumber(), 1);
+  ASSERT_EQ(arena.GetMappedBytes(), 64 << 10);
+}
+
+TEST(BufferArena, DoesNotWasteLargeBuffers) {
+  ts::BufferArena arena;
+  arena.Acquire(1 << 20);
+  auto buffer = arena.Acquire(4 << 10);
+  ASSERT_EQ(arena.GetMapsNumber(), 2);
+  // the large one is still there for a large request
+  auto large_buffer = arena.Acquire(1 << 20);
+  ASSERT_EQ(arena.GetMapsNumber(), 2);
+}
+
+TEST(BufferArena, BuffersInUseAreDistinct) {
+  ts::BufferArena arena;
+  auto first = arena.Acquire(4 << 10);
+  auto second = arena.Acquire(4 << 10);
+  ASSERT_NE(first.Data(), second.Data());
+
+  second = std::move(first);
+  ASSERT_EQ(first.Data(), nullptr);
+  // the buffer second owned has been released
+  auto third = arena.Acquire(4 << 10);
+  ASSERT_EQ(arena.GetMapsNumber(), 2);
+  ASSERT_NE(third.Data(), second.Data());
+}
+
+TEST(BufferArena, Trim) {
+  ts::BufferArena arena;
+  auto buffer = arena.Acquire(8 << 10);
+  arena.Acquire(16 << 10);
+  ASSERT_EQ(arena.GetMappedBytes(), 24 << 10);
+  arena.Trim();
+  ASSERT_EQ(arena.GetMappedBytes(), 8 << 10);
+}
+
+TEST(BufferArena, HugePages) {
+  ts::BufferArena arena{true};
+  auto buffer = arena.Acquire(1);
+  ASSERT_EQ(arena.GetMappedBytes(), 2 << 20);
+  // the kernel backs only aligned ranges with huge pages
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(buffer.Data()) % (2 << 20), 0);
+}
@@ -54,6 +54,59 @@ TEST_F(TestDelayConfig, Correct) {
   ASSERT_EQ(config.read_delay.count(), read_delay);
   ASSERT_EQ(config.write_delay.count(), write_delay);
   ASSERT_EQ(config.rewind_delay.count(), rewind_delay);
+  ASSERT_EQ(config.GetMoveBackwardDelay().count(), move_delay);
+}
+
+TEST_F(TestDelayConfig, MoveBackwardDelay) {
+  std::stringstream config_stream;
+  auto move_backward_delay = 5;
+
+  config_stream << "move_delay = 1\n";
+  config_stream << "read_delay = 2\n";
+  config_stream << "write_delay = 3\n";
+  config_stream << "rewind_delay = 4\n";
+  config_stream << "move_backward_delay = " << move_backward_delay << '\n';
+  WriteConfig(config_stream);
+  auto config = ts::TapeDelayConfigParser::Parse(GetTempConfigPath());
+
+  ASSERT_EQ(config.move_delay.count(), 1);
+  ASSERT_EQ(config.GetMoveBackwardDelay().count(), move_backward_delay);
+}
+
+TEST_F(TestDelayConfig, LatencyModel) {
+  std::stringstream config_stream;
+  config_stream << "move_delay = 1\n";
+  config_stream << "read_delay = 2\n";
+  config_stream << "write_delay = 3\n";
+  config_stream << "rewind_delay = 4\n";
+  config_stream << "start_stop_delay_us = 5\n";
+  config_stream << "streaming_delay_us = 6\n";
+  config_stream << "repositioning_delay_us = 7\n";
+  config_stream << "rewind_delay_per_value_us = 8\n";
+  config_stream << "jitter = 0.25\n";
+  config_stream << "seed = 42\n";
+  WriteConfig(config_stream);
+  auto config = ts::TapeDelayConfigParser::Parse(GetTempConfigPath());
+
+  const auto& model = config.latency_model;
+  ASSERT_EQ(model.start_stop_delay.count(), 5);
+  ASSERT_EQ(model.streaming_delay.count(), 6);
+  ASSERT_EQ(model.repositioning_delay.count(), 7);
+  ASSERT_EQ(model.rewind_delay_per_value.count(), 8);
+  ASSERT_DOUBLE_EQ(config.jitter, 0.25);
+  ASSERT_EQ(config.seed, 42);
+}
+
+TEST_F(TestDelayConfig, InvalidJitter) {
+  std::stringstream config_stream;
+  config_stream << "move_delay = 1\n";
+  config_stream << "read_delay = 2\n";
+  config_stream << "write_delay = 3\n";
+  config_stream << "rewind_delay = 4\n";
+  config_stream << "jitter = 1.5\n";
+  WriteConfig(config_stream);
+  ASSERT_THROW(ts::TapeDelayConfigParser::Parse(GetTempConfigPath()),
+               std::invalid_argument);
 }
 
 TEST_F(TestDelayConfig, EmptyKey) {
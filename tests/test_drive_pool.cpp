@@ -0,0 +1,248 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/file_tape.h>
+#include <tape_sorter/sort/drive_pool.h>
+#include <tape_sorter/sort/tape_sorter.h>
+#include <tape_sorter/sort/temp_file_tape_creator.h>
+
+namespace ts = tape_sorter;
+namespace fs = std::filesystem;
+
+namespace {
+
+size_t GetMaxMountedNumber(const std::vector<ts::DriveEvent>& schedule) {
+  size_t mounted = 0;
+  size_t max_mounted = 0;
+  for (const auto& event : schedule) {
+    if (event.kind == ts::DriveEventKind::kMount) {
+      max_mounted = std::max(max_mounted, ++mounted);
+    } else {
+      --mounted;
+    }
+  }
+  return max_mounted;
+}
+
+// Forwards to a pool but reports every tape mounted, so the runs are merged
+// in the order of the input
+class MountUnawareCreator : public ts::ITempTapeCreator {
+ public:
+  explicit MountUnawareCreator(std::unique_ptr<ts::DrivePool> pool)
+      : pool_(std::move(pool)) {}
+
+  std::unique_ptr<ts::ITape> Create() override { return pool_->Create(); }
+
+  std::unique_ptr<ts::ITape> CreateForMerge(
+      const std::vector<const ts::ITape*>& source_tapes) override {
+    return pool_->CreateForMerge(source_tapes);
+  }
+
+  size_t GetMaxMountedTapes() const override {
+    return pool_->GetMaxMountedTapes();
+  }
+
+  bool TakesDrive(const ts::ITape& tape) const override {
+    return pool_->TakesDrive(tape);
+  }
+
+ private:
+  std::unique_ptr<ts::DrivePool> pool_;
+};
+
+}  // namespace
+
+TEST(DrivePool, NoDrives) {
+  ASSERT_THROW(ts::DrivePool(std::make_unique<ts::TempFileTapeCreator>(),
+                             {.drives_number = 0}),
+               std::invalid_argument);
+}
+
+TEST(DrivePool, MountsOnFirstUse) {
+  ts::DrivePool pool(std::make_unique<ts::TempFileTapeCreator>(),
+                     {2, std::chrono::milliseconds{3},
+                      std::chrono::milliseconds{1}});
+  auto tape = pool.Create();
+  ASSERT_EQ(pool.GetMountsNumber(), 0);
+
+  tape->WriteForward(1);
+  tape->WriteForward(2);
+  tape->Rewind();
+  ASSERT_EQ(tape->ReadForward(), 1);
+  ASSERT_EQ(pool.GetMountsNumber(), 1);
+  ASSERT_EQ(pool.GetModeledTime(), std::chrono::milliseconds{3});
+
+  tape.reset();
+  ASSERT_EQ(pool.GetModeledTime(), std::chrono::milliseconds{4});
+  ASSERT_EQ(pool.GetSchedule().size(), 2);
+  ASSERT_EQ(pool.GetSchedule().back().kind, ts::DriveEventKind::kUnmount);
+}
+
+TEST(DrivePool, EvictsLeastRecentlyUsed) {
+  ts::DrivePool pool(std::make_unique<ts::TempFileTapeCreator>(), {2});
+  auto first = pool.Create();
+  auto second = pool.Create();
+  auto third = pool.Create();
+  first->WriteForward(1);
+  second->WriteForward(2);
+  first->WriteForward(3);
+  third->WriteForward(4);
+
+  const auto& schedule = pool.GetSchedule();
+  ASSERT_EQ(pool.GetMountsNumber(), 3);
+  ASSERT_EQ(schedule.size(), 4);
+  ASSERT_EQ(schedule[2].kind, ts::DriveEventKind::kUnmount);
+  ASSERT_EQ(schedule[2].cartridge, 1);
+  ASSERT_EQ(schedule[3].kind, ts::DriveEventKind::kMount);
+  ASSERT_EQ(schedule[3].drive, schedule[1].drive);
+
+  // The evicted cartridge keeps its values
+  second->Rewind();
+  ASSERT_EQ(second->ReadForward(), 2);
+  ASSERT_EQ(pool.GetMountsNumber(), 4);
+}
+
+TEST(DrivePool, TellsMountedCartridges) {
+  ts::DrivePool pool(std::make_unique<ts::TempFileTapeCreator>(), {1});
+  auto first = pool.Create();
+  auto second = pool.Create();
+  ts::TempFileTapeCreator other_creator;
+  auto other = other_creator.Create();
+  ASSERT_TRUE(pool.TakesDrive(*first));
+  ASSERT_FALSE(pool.TakesDrive(*other));
+  ASSERT_TRUE(pool.IsMounted(*other));
+  ASSERT_FALSE(pool.IsMounted(*first));
+
+  first->WriteForward(1);
+  ASSERT_TRUE(pool.IsMounted(*first));
+  second->WriteForward(2);
+  ASSERT_FALSE(pool.IsMounted(*first));
+  ASSERT_TRUE(pool.IsMounted(*second));
+}
+
+class SortWithDrives : public ::testing::TestWithParam<size_t> {
+  static constexpr const auto kInputTapeFilename = "test_drive_input";
+  static constexpr const auto kOutputTapeFilename = "test_drive_output";
+
+ protected:
+  void TearDown() override {
+    fs::remove(GetInputTapePath());
+    fs::remove(GetOutputTapePath());
+  }
+
+  fs::path GetInputTapePath() const {
+    return fs::current_path() / kInputTapeFilename;
+  }
+
+  fs::path GetOutputTapePath() const {
+    return fs::current_path() / kOutputTapeFilename;
+  }
+
+  std::vector<int> WriteRandomInput(size_t numbers_number) const {
+    std::mt19937 generator(GetParam());
+    std::uniform_int_distribution<> distribution(-1000, 1000);
+    std::vector<int> numbers(numbers_number);
+    for (auto& value : numbers) {
+      value = distribution(generator);
+    }
+    std::ofstream file(GetInputTapePath());
+    for (auto value : numbers) {
+      file.write(reinterpret_cast<char*>(&value), sizeof(int));
+    }
+    return numbers;
+  }
+};
+
+TEST(SortWithDrivesTooFew, Throws) {
+  ASSERT_THROW(ts::TapeSorter(10, std::make_unique<ts::DrivePool>(
+                                      std::make_unique<ts::TempFileTapeCreator>(),
+                                      ts::DrivePoolConfig{2})),
+               std::invalid_argument);
+}
+
+TEST_P(SortWithDrives, RandomValues) {
+  constexpr const size_t kNumbers = 10000;
+  constexpr const size_t kBufferSize = 100;
+  auto drives_number = GetParam();
+  auto expected_numbers = WriteRandomInput(kNumbers);
+
+  auto pool = std::make_unique<ts::DrivePool>(
+      std::make_unique<ts::TempFileTapeCreator>(),
+      ts::DrivePoolConfig{drives_number, std::chrono::milliseconds{1}});
+  auto& pool_ref = *pool;
+  ts::FileTape input_tape(GetInputTapePath());
+  ts::FileTape output_tape(GetOutputTapePath());
+  // The sorter owns the pool
+  ts::TapeSorter sorter(kBufferSize, std::move(pool));
+  auto statistics = sorter.Sort(input_tape, output_tape);
+
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  std::ifstream file(GetOutputTapePath());
+  std::vector<int> numbers;
+  int value;
+  while (file.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+    numbers.push_back(value);
+  }
+  ASSERT_EQ(numbers, expected_numbers);
+
+  ASSERT_EQ(statistics.runs_number, kNumbers / kBufferSize);
+  ASSERT_GT(statistics.early_merges_number, 0);
+  ASSERT_EQ(statistics.schedule.size(),
+            statistics.runs_number + statistics.early_merges_number + 1);
+  ASSERT_EQ(statistics.schedule.back().kind, ts::SortStepKind::kFinalMerge);
+  // the output tape of the final merge takes no drive
+  for (const auto& step : statistics.schedule) {
+    if (step.kind == ts::SortStepKind::kFinalMerge) {
+      ASSERT_LE(step.tapes_number, drives_number);
+    } else {
+      ASSERT_LT(step.tapes_number, drives_number);
+    }
+  }
+  ASSERT_EQ(statistics.schedule.back().values_number, kNumbers);
+  ASSERT_LE(GetMaxMountedNumber(pool_ref.GetSchedule()), drives_number);
+  ASSERT_GE(statistics.modeled_time,
+            std::chrono::milliseconds{pool_ref.GetMountsNumber()});
+}
+
+TEST_P(SortWithDrives, MountedRunsMergedFirst) {
+  constexpr const size_t kNumbers = 10000;
+  constexpr const size_t kBufferSize = 100;
+  auto drives_number = GetParam();
+  WriteRandomInput(kNumbers);
+  auto sort = [&](auto make_creator) {
+    auto pool = std::make_unique<ts::DrivePool>(
+        std::make_unique<ts::TempFileTapeCreator>(),
+        ts::DrivePoolConfig{drives_number});
+    const auto& pool_ref = *pool;
+    ts::FileTape input_tape(GetInputTapePath());
+    ts::FileTape output_tape(GetOutputTapePath());
+    ts::TapeSorter sorter(kBufferSize, make_creator(std::move(pool)));
+    sorter.Sort(input_tape, output_tape);
+    return pool_ref.GetMountsNumber();
+  };
+
+  auto mounts_number = sort([](auto pool) { return pool; });
+  auto naive_mounts_number = sort([](auto pool) {
+    return std::make_unique<MountUnawareCreator>(std::move(pool));
+  });
+  ASSERT_LT(mounts_number, naive_mounts_number);
+}
+
+INSTANTIATE_TEST_SUITE_P(Sort, SortWithDrives, testing::Values(3, 4, 8));
@@ -155,3 +155,337 @@ TEST_F(TestTape, WriteBeforeBegin) {
   tape.MoveBackward();  // move to before_begin
   ASSERT_THROW(tape.Write(1), std::out_of_range);
 }
+
+TEST_F(TestTape, MoveForwardFromBeforeBegin) {
+  WriteNumbers({1, 2});
+  auto& tape = GetTape();
+  tape.MoveBackward();  // move to before_begin
+  ASSERT_TRUE(tape.MoveForward());
+  ASSERT_EQ(tape.Read().value(), 1);
+}
+
+TEST_F(TestTape, ReadForward) {
+  constexpr const auto kWritesNumber = 50;
+  std::vector<int> expected_numbers(kWritesNumber);
+  std::iota(expected_numbers.begin(), expected_numbers.end(), 0);
+  WriteNumbers(expected_numbers);
+
+  std::vector<int> actual_numbers;
+  auto& tape = GetTape();
+  while (auto value = tape.ReadForward()) {
+    actual_numbers.push_back(value.value());
+  }
+
+  ASSERT_EQ(actual_numbers, expected_numbers);
+  const auto& counts = tape.GetOperationCounts();
+  // one read and one move per element plus the read hitting the end
+  ASSERT_EQ(counts.reads, kWritesNumber + 1);
+  ASSERT_EQ(counts.moves, kWritesNumber);
+  ASSERT_EQ(counts.writes, 0);
+}
+
+TEST_F(TestTape, ReadBackward) {
+  constexpr const auto kWritesNumber = 50;
+  std::vector<int> expected_numbers(kWritesNumber);
+  std::iota(expected_numbers.begin(), expected_numbers.end(), 0);
+  WriteNumbers(expected_numbers);
+
+  auto& tape = GetTape();
+  while (tape.ReadForward()) {
+  }
+  tape.MoveBackward();
+  std::vector<int> actual_numbers;
+  while (auto value = tape.ReadBackward()) {
+    actual_numbers.push_back(value.value());
+  }
+  std::reverse(expected_numbers.begin(), expected_numbers.end());
+
+  ASSERT_EQ(actual_numbers, expected_numbers);
+  const auto& counts = tape.GetOperationCounts();
+  ASSERT_EQ(counts.reads, 2 * (kWritesNumber + 1));
+  ASSERT_EQ(counts.moves, 2 * kWritesNumber + 1);
+  ASSERT_EQ(counts.backward_moves, kWritesNumber + 1);
+}
+
+TEST_F(TestTape, WriteForward) {
+  constexpr const auto kWritesNumber = 50;
+  auto& tape = GetTape();
+  std::vector<int> expected;
+  expected.reserve(kWritesNumber);
+  for (auto i = 0; i != kWritesNumber; ++i) {
+    tape.WriteForward(i);
+    expected.push_back(i);
+  }
+
+  ASSERT_EQ(expected, ReadNumbers());
+  const auto& counts = tape.GetOperationCounts();
+  ASSERT_EQ(counts.writes, kWritesNumber);
+  ASSERT_EQ(counts.moves, kWritesNumber);
+  ASSERT_EQ(counts.reads, 0);
+}
+
+TEST_F(TestTape, MoveForwardDoesNotRead) {
+  WriteNumbers({1, 2, 3});
+  auto& tape = GetTape();
+  while (tape.MoveForward()) {
+  }
+  ASSERT_EQ(tape.GetOperationCounts().reads, 0);
+  ASSERT_EQ(tape.GetOperationCounts().moves, 4);
+}
+
+TEST_F(TestTape, Seek) {
+  std::vector<int> numbers(100);
+  std::iota(numbers.begin(), numbers.end(), 0);
+  WriteNumbers(numbers);
+  auto& tape = GetTape();
+
+  tape.Seek(42);
+  ASSERT_EQ(tape.Read(), 42);
+  tape.Seek(7);
+  ASSERT_EQ(tape.ReadForward(), 7);
+  ASSERT_EQ(tape.Read(), 8);
+  // just past the last value
+  tape.Seek(100);
+  ASSERT_FALSE(tape.Read());
+  ASSERT_THROW(tape.Seek(101), std::out_of_range);
+  ASSERT_EQ(tape.GetOperationCounts().seeks, 3);
+}
+
+TEST_F(TestTape, LatencyModel) {
+  ts::TapeDelayConfig config;
+  config.latency_model.start_stop_delay = std::chrono::microseconds(100);
+  config.latency_model.streaming_delay = std::chrono::microseconds(10);
+  config.latency_model.repositioning_delay = std::chrono::microseconds(50);
+  config.latency_model.rewind_delay_per_value = std::chrono::microseconds(1);
+  ts::FileTape tape(GetTempTapePath(), config);
+  const auto& counts = tape.GetOperationCounts();
+
+  // one start, then streaming
+  for (auto i = 0; i != 10; ++i) {
+    tape.WriteForward(i);
+  }
+  ASSERT_EQ(counts.total_delay.count(), 100 + 10 * 10);
+  // proportional to the distance
+  tape.Rewind();
+  ASSERT_EQ(counts.total_delay.count(), 200 + 10);
+  // a start from the stop, then seeking
+  for (auto i = 0; i != 3; ++i) {
+    tape.MoveForward();
+  }
+  ASSERT_EQ(counts.total_delay.count(), 210 + 100 + 3 * 50);
+  // a reversal
+  tape.ReadBackward();
+  ASSERT_EQ(counts.total_delay.count(), 460 + 100 + 10);
+}
+
+TEST_F(TestTape, Jitter) {
+  constexpr const auto kValues = 100;
+  ts::TapeDelayConfig config;
+  config.latency_model.streaming_delay = std::chrono::microseconds(100);
+  config.jitter = 0.5;
+  config.seed = 7;
+  auto write_values = [&config](const fs::path& path) {
+    ts::FileTape tape(path, config);
+    for (auto i = 0; i != kValues; ++i) {
+      tape.WriteForward(i);
+    }
+    return tape.GetOperationCounts().total_delay;
+  };
+
+  auto delay = write_values(GetTempTapePath());
+  ASSERT_NE(delay.count(), kValues * 100);
+  ASSERT_GE(delay.count(), kValues * 50);
+  ASSERT_LE(delay.count(), kValues * 150);
+  // the same seed gives the same delays
+  ASSERT_EQ(write_values(GetTempTapePath()), delay);
+}
+
+class TestTapeBackend : public TestTape,
+                        public testing::WithParamInterface<ts::FileTapeBackend> {
+ protected:
+  ts::FileTape CreateTape() {
+    return ts::FileTape(GetTempTapePath(), {}, GetParam());
+  }
+
+  ts::FileTape CreateFramedTape() {
+    return ts::FileTape(GetTempTapePath(), {}, GetParam(),
+                        std::make_shared<ts::TapeOperationCounts>(), nullptr,
+                        ts::FileTapeFormat::kFramed);
+  }
+};
+
+// Large enough to span many blocks of the direct backend
+constexpr const auto kManyBlocksNumber = 100000;
+
+TEST_P(TestTapeBackend, ReadForwardAndBackward) {
+  std::vector<int> expected_numbers(kManyBlocksNumber);
+  std::iota(expected_numbers.begin(), expected_numbers.end(), 0);
+  auto tape = CreateTape();
+  for (auto value : expected_numbers) {
+    tape.WriteForward(value);
+  }
+  tape.Rewind();
+
+  std::vector<int> actual_numbers;
+  while (auto value = tape.ReadForward()) {
+    actual_numbers.push_back(value.value());
+  }
+  ASSERT_EQ(actual_numbers, expected_numbers);
+
+  tape.MoveBackward();
+  actual_numbers.clear();
+  while (auto value = tape.ReadBackward()) {
+    actual_numbers.push_back(value.value());
+  }
+  std::reverse(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(actual_numbers, expected_numbers);
+}
+
+TEST_P(TestTapeBackend, Flush) {
+  std::vector<int> expected_numbers(kManyBlocksNumber + 1);
+  std::iota(expected_numbers.begin(), expected_numbers.end(), 0);
+  auto tape = CreateTape();
+  for (auto value : expected_numbers) {
+    tape.WriteForward(value);
+  }
+  tape.Flush();
+
+  ASSERT_EQ(fs::file_size(GetTempTapePath()),
+            expected_numbers.size() * sizeof(int));
+  ASSERT_EQ(ReadNumbers(), expected_numbers);
+}
+
+TEST_P(TestTapeBackend, ReadExisting) {
+  std::vector<int> expected_numbers(kManyBlocksNumber);
+  std::iota(expected_numbers.begin(), expected_numbers.end(), 0);
+  WriteNumbers(expected_numbers);
+  auto tape = CreateTape();
+
+  std::vector<int> actual_numbers;
+  while (auto value = tape.ReadForward()) {
+    actual_numbers.push_back(value.value());
+  }
+  ASSERT_EQ(actual_numbers, expected_numbers);
+}
+
+TEST_P(TestTapeBackend, Overwrite) {
+  std::vector<int> expected_numbers(kManyBlocksNumber);
+  std::iota(expected_numbers.begin(), expected_numbers.end(), 0);
+  WriteNumbers(expected_numbers);
+  {
+    auto tape = CreateTape();
+    for (auto i = 0; i != kManyBlocksNumber / 2; ++i) {
+      tape.MoveForward();
+    }
+    for (auto i = kManyBlocksNumber / 2; i != kManyBlocksNumber / 2 + 100;
+         ++i) {
+      tape.WriteForward(-i);
+      expected_numbers[i] = -i;
+    }
+  }
+  ASSERT_EQ(ReadNumbers(), expected_numbers);
+}
+
+TEST_P(TestTapeBackend, Framed) {
+  constexpr const size_t kHeaderSize = 64;
+  constexpr const size_t kBlockValues = 4096;
+  std::vector<int> expected_numbers(kManyBlocksNumber);
+  std::iota(expected_numbers.begin(), expected_numbers.end(), -10);
+  {
+    auto tape = CreateFramedTape();
+    ASSERT_EQ(tape.GetFormat(), ts::FileTapeFormat::kFramed);
+    for (auto value : expected_numbers) {
+      tape.WriteForward(value);
+    }
+  }
+  auto blocks_number = (kManyBlocksNumber + kBlockValues - 1) / kBlockValues;
+  ASSERT_EQ(fs::file_size(GetTempTapePath()),
+            kHeaderSize + (kManyBlocksNumber + blocks_number) * sizeof(int));
+
+  // the format of an existing file is detected
+  auto tape = CreateTape();
+  ASSERT_EQ(tape.GetFormat(), ts::FileTapeFormat::kFramed);
+  auto metadata = tape.GetMetadata().value();
+  ASSERT_EQ(metadata.values_number, kManyBlocksNumber);
+  ASSERT_EQ(metadata.min, -10);
+  ASSERT_EQ(metadata.max, kManyBlocksNumber - 11);
+  ASSERT_EQ(metadata.sort_order, ts::SortOrder::kAscending);
+  ASSERT_TRUE(tape.VerifyChecksums());
+  std::vector<int> actual_numbers;
+  while (auto value = tape.ReadForward()) {
+    actual_numbers.push_back(value.value());
+  }
+  ASSERT_EQ(actual_numbers, expected_numbers);
+}
+
+TEST_P(TestTapeBackend, FramedAppendAndOverwrite) {
+  {
+    auto tape = CreateFramedTape();
+    for (auto value : {5, 4, 4}) {
+      tape.WriteForward(value);
+    }
+  }
+  auto tape = CreateFramedTape();
+  while (tape.MoveForward()) {
+  }
+  tape.WriteForward(1);
+  auto metadata = tape.GetMetadata().value();
+  ASSERT_EQ(metadata.values_number, 4);
+  ASSERT_EQ(metadata.min, 1);
+  ASSERT_EQ(metadata.sort_order, ts::SortOrder::kDescending);
+
+  // overwriting a value takes a scan to know the metadata again
+  tape.Rewind();
+  tape.Write(0);
+  ASSERT_FALSE(tape.GetMetadata());
+  tape.Flush();
+  metadata = tape.GetMetadata().value();
+  ASSERT_EQ(metadata.values_number, 4);
+  ASSERT_EQ(metadata.min, 0);
+  ASSERT_EQ(metadata.max, 4);
+  ASSERT_EQ(metadata.sort_order, ts::SortOrder::kNone);
+  ASSERT_TRUE(tape.VerifyChecksums());
+}
+
+INSTANTIATE_TEST_SUITE_P(Backend, TestTapeBackend,
+                         testing::Values(ts::FileTapeBackend::kStream,
+                                         ts::FileTapeBackend::kDirect));
+
+TEST_F(TestTape, RawIsNotFramed) {
+  WriteNumbers({1, 2, 3});
+  auto tape = ts::FileTape(GetTempTapePath(), {}, ts::FileTapeBackend::kStream,
+                           std::make_shared<ts::TapeOperationCounts>(),
+                           nullptr, ts::FileTapeFormat::kFramed);
+  ASSERT_EQ(tape.GetFormat(), ts::FileTapeFormat::kRaw);
+  ASSERT_FALSE(tape.GetMetadata());
+  ASSERT_TRUE(tape.VerifyChecksums());
+}
+
+TEST_F(TestTape, FramedCorruption) {
+  constexpr const auto kValuesNumber = 10000;
+  {
+    auto tape =
+        ts::FileTape(GetTempTapePath(), {}, ts::FileTapeBackend::kStream,
+                     std::make_shared<ts::TapeOperationCounts>(), nullptr,
+                     ts::FileTapeFormat::kFramed);
+    for (auto i = 0; i != kValuesNumber; ++i) {
+      tape.WriteForward(i);
+    }
+  }
+  auto corrupt_byte = [this](std::streamoff offset) {
+    std::fstream file(GetTempTapePath(),
+                      std::fstream::in | std::fstream::out |
+                          std::fstream::binary);
+    file.seekg(offset);
+    auto byte = static_cast<char>(file.get() ^ 1);
+    file.seekp(offset);
+    file.put(byte);
+  };
+
+  // a value of the second block
+  corrupt_byte(64 + 5000 * sizeof(int));
+  ASSERT_FALSE(ts::FileTape(GetTempTapePath()).VerifyChecksums());
+  // the number of values
+  corrupt_byte(16);
+  ASSERT_THROW(ts::FileTape{GetTempTapePath()}, std::runtime_error);
+}
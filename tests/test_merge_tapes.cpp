@@ -0,0 +1,223 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <random>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/file_tape.h>
+#include <tape_sorter/sort/merge_tapes.h>
+#include <tape_sorter/sort/temp_file_tape_creator.h>
+
+#include "file_tapes_test.h"
+
+namespace ts = tape_sorter;
+
+class MergeData : public FileTapesTest {
+ protected:
+  MergeData() : FileTapesTest("merge_tapes_data") {}
+
+  // Creates a tape holding the values reversed with its head on the last
+  // one, which is the first value
+  ts::FileTape& CreateBackwardTape(const std::vector<int>& values) {
+    auto& tape = CreateTape({values.rbegin(), values.rend()});
+    while (tape.MoveForward()) {
+    }
+    tape.MoveBackward();
+    return tape;
+  }
+
+  // Sorted chunks of random values, returns them all sorted
+  std::vector<int> GenerateSortedChunks(size_t chunks_number,
+                                        size_t chunk_size,
+                                        std::vector<std::vector<int>>& chunks) {
+    std::mt19937 generator(chunks_number);
+    std::uniform_int_distribution<> distribution(-100, 100);
+    std::vector<int> all_values;
+    for (auto i = 0ul; i != chunks_number; ++i) {
+      std::vector<int> chunk;
+      for (auto j = 0ul; j != chunk_size + i; ++j) {
+        chunk.push_back(distribution(generator));
+      }
+      std::sort(chunk.begin(), chunk.end());
+      all_values.insert(all_values.end(), chunk.begin(), chunk.end());
+      chunks.push_back(std::move(chunk));
+    }
+    std::sort(all_values.begin(), all_values.end());
+    return all_values;
+  }
+};
+
+TEST_F(MergeData, Forward) {
+  std::vector<std::vector<int>> chunks;
+  auto expected = GenerateSortedChunks(5, 100, chunks);
+  std::vector<ts::ITape*> inputs;
+  for (const auto& chunk : chunks) {
+    inputs.push_back(&CreateTape(chunk));
+  }
+  auto& output = CreateTape({});
+
+  ts::MergeTapes(inputs, output);
+  ASSERT_EQ(ReadAll(output), expected);
+}
+
+TEST_F(MergeData, Backward) {
+  std::vector<std::vector<int>> chunks;
+  auto expected = GenerateSortedChunks(5, 100, chunks);
+  std::vector<ts::ITape*> inputs;
+  for (const auto& chunk : chunks) {
+    inputs.push_back(&CreateBackwardTape(chunk));
+  }
+  auto& output = CreateTape({});
+
+  ts::MergeOptions options;
+  options.input_layout = ts::RunLayout::kBackward;
+  ts::MergeTapes(inputs, output, options);
+  ASSERT_EQ(ReadAll(output), expected);
+}
+
+TEST_F(MergeData, MixedLayouts) {
+  std::vector<std::vector<int>> chunks;
+  auto expected = GenerateSortedChunks(6, 100, chunks);
+  std::vector<ts::MergeSource> sources;
+  for (auto i = 0ul; i != chunks.size(); ++i) {
+    if (i % 2 == 0) {
+      sources.push_back({&CreateTape(chunks[i]), ts::RunLayout::kForward});
+    } else {
+      sources.push_back(
+          {&CreateBackwardTape(chunks[i]), ts::RunLayout::kBackward});
+    }
+  }
+  auto& output = CreateTape({});
+
+  ts::MergeSources(sources, output);
+  ASSERT_EQ(ReadAll(output), expected);
+}
+
+TEST_F(MergeData, BoundedFanIn) {
+  constexpr const size_t kTapesNumber = 10;
+  constexpr const size_t kFanIn = 3;
+  std::vector<std::vector<int>> chunks;
+  auto expected = GenerateSortedChunks(kTapesNumber, 100, chunks);
+  std::vector<ts::ITape*> inputs;
+  for (const auto& chunk : chunks) {
+    inputs.push_back(&CreateBackwardTape(chunk));
+  }
+  auto& output = CreateTape({});
+  ts::TempFileTapeCreator temp_tape_creator;
+
+  ts::MergeOptions options;
+  options.input_layout = ts::RunLayout::kBackward;
+  options.max_fan_in = kFanIn;
+  ts::MergeTapes(inputs, output, options, &temp_tape_creator);
+  ASSERT_EQ(ReadAll(output), expected);
+  // every intermediate pass replaces fan-in tapes by one, the first pass is
+  // shortened so that the last one merges exactly fan-in tapes
+  auto passes = (kTapesNumber - kFanIn + kFanIn - 2) / (kFanIn - 1);
+  ASSERT_EQ(temp_tape_creator.GetCreatedTapesNumber(), passes);
+  // each value is written once by the intermediate passes but the shortened
+  // one, which merges two tapes
+  ASSERT_LT(temp_tape_creator.GetOperationCounts().writes,
+            passes * expected.size());
+}
+
+TEST_F(MergeData, Descending) {
+  auto& first = CreateTape({9, 4, 4, 1});
+  auto& second = CreateTape({8, 4, 0});
+  auto& output = CreateTape({});
+
+  ts::MergeTapes<std::greater<int>>({&first, &second}, output);
+  ASSERT_EQ(ReadAll(output), (std::vector<int>{9, 8, 4, 4, 4, 1, 0}));
+}
+
+// Orders the values by their tens only
+struct TensComparator {
+  bool operator()(int lhs, int rhs) const { return lhs / 10 < rhs / 10; }
+};
+
+TEST_F(MergeData, StableBoundedFanIn) {
+  constexpr const int kTapesNumber = 7;
+  std::vector<ts::ITape*> inputs;
+  std::vector<int> expected;
+  for (int tape = 0; tape != kTapesNumber; ++tape) {
+    // the units tell the tapes apart
+    std::vector<int> values;
+    for (int tens = 0; tens != 5; ++tens) {
+      values.push_back(tens * 10 + tape);
+      expected.push_back(tens * 10 + tape);
+    }
+    inputs.push_back(&CreateTape(values));
+  }
+  std::sort(expected.begin(), expected.end());
+  auto& output = CreateTape({});
+  ts::TempFileTapeCreator temp_tape_creator;
+
+  ts::MergeOptions options;
+  options.max_fan_in = 3;
+  ts::MergeTapes<TensComparator, ts::SortStability::kStable>(
+      inputs, output, options, &temp_tape_creator);
+  ASSERT_EQ(ReadAll(output), expected);
+}
+
+TEST_F(MergeData, DropEquivalent) {
+  auto& first = CreateTape({1, 12, 25});
+  auto& second = CreateTape({5, 17, 31});
+  auto& output = CreateTape({});
+
+  ts::MergeOptions options;
+  options.duplicate_policy = ts::DuplicatePolicy::kDrop;
+  ts::MergeTapes<TensComparator, ts::SortStability::kStable>(
+      {&first, &second}, output, options);
+  ASSERT_EQ(ReadAll(output), (std::vector<int>{1, 12, 25, 31}));
+}
+
+TEST_F(MergeData, DropDuplicates) {
+  auto& first = CreateTape({1, 1, 2, 5});
+  auto& second = CreateTape({1, 3, 5, 5, 6});
+  auto& output = CreateTape({});
+
+  ts::MergeOptions options;
+  options.duplicate_policy = ts::DuplicatePolicy::kDrop;
+  ts::MergeTapes({&first, &second}, output, options);
+  ASSERT_EQ(ReadAll(output), (std::vector<int>{1, 2, 3, 5, 6}));
+}
+
+TEST_F(MergeData, EmptyTapes) {
+  auto& first = CreateTape({});
+  auto& second = CreateTape({1, 2});
+  auto& output = CreateTape({});
+
+  ts::MergeTapes({&first, &second}, output);
+  ASSERT_EQ(ReadAll(output), (std::vector<int>{1, 2}));
+
+  auto& empty_output = CreateTape({});
+  ts::MergeTapes({}, empty_output);
+  ASSERT_TRUE(ReadAll(empty_output).empty());
+}
+
+TEST_F(MergeData, FanInRequiresTempTapes) {
+  auto& first = CreateTape({1});
+  auto& second = CreateTape({2});
+  auto& third = CreateTape({3});
+  auto& output = CreateTape({});
+
+  ts::MergeOptions options;
+  options.max_fan_in = 2;
+  ASSERT_THROW(ts::MergeTapes({&first, &second, &third}, output, options),
+               std::invalid_argument);
+  options.max_fan_in = 1;
+  ts::TempFileTapeCreator temp_tape_creator;
+  ASSERT_THROW(ts::MergeTapes({&first, &second, &third}, output, options,
+                              &temp_tape_creator),
+               std::invalid_argument);
+}
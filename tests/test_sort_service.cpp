@@ -0,0 +1,115 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <random>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/file_tape.h>
+#include <tape_sorter/sort/sort_service.h>
+
+#include "file_tapes_test.h"
+
+namespace ts = tape_sorter;
+
+class SortServiceData : public FileTapesTest {
+ protected:
+  SortServiceData() : FileTapesTest("sort_service_data") {}
+
+  static std::vector<int> GenerateValues(size_t size, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<> distribution;
+    std::vector<int> values(size);
+    for (auto& value : values) {
+      value = distribution(generator);
+    }
+    return values;
+  }
+};
+
+TEST_F(SortServiceData, TooSmallBudget) {
+  ASSERT_THROW(ts::SortService({2, ts::MemoryBudget{1 << 20}, 2 << 20}),
+               std::invalid_argument);
+}
+
+TEST_F(SortServiceData, SortsJobs) {
+  constexpr const size_t kJobsNumber = 6;
+  // two jobs run at once, each sorts in several blocks
+  ts::SortService service({4, ts::MemoryBudget{128 << 10}, 64 << 10});
+  std::vector<std::vector<int>> expected;
+  std::vector<ts::FileTape*> outputs;
+  std::vector<ts::SortJobId> job_ids;
+  for (size_t i = 0; i != kJobsNumber; ++i) {
+    auto values = GenerateValues(50000 + i * 10000, i);
+    auto& input = CreateTape(values);
+    auto& output = CreateTape({});
+    ts::SortOptions options;
+    options.verify = true;
+    job_ids.push_back(service.Submit(
+        input, output, std::make_unique<ts::TempFileTapeCreator>(), options));
+    ASSERT_LE(service.GetRunningJobsNumber(), 2);
+    std::sort(values.begin(), values.end());
+    expected.push_back(std::move(values));
+    outputs.push_back(&output);
+  }
+
+  for (size_t i = 0; i != kJobsNumber; ++i) {
+    auto statistics = service.Wait(job_ids[i]);
+    ASSERT_EQ(statistics.values_number, expected[i].size());
+    ASSERT_GT(statistics.runs_number, 1);
+    ASSERT_EQ(ReadAll(*outputs[i]), expected[i]);
+
+    auto status = service.GetStatus(job_ids[i]);
+    ASSERT_EQ(status.state, ts::SortJobState::kDone);
+    ASSERT_EQ(status.values_read, expected[i].size());
+    ASSERT_EQ(status.values_written, expected[i].size());
+    ASSERT_EQ(status.granted_memory, 0);
+    ASSERT_GT(status.values_per_second, 0);
+  }
+  ASSERT_EQ(service.GetRunningJobsNumber(), 0);
+}
+
+TEST_F(SortServiceData, SplitsMemory) {
+  constexpr const size_t kBudget = 1 << 20;
+  ts::SortService service({1, ts::MemoryBudget{kBudget}, 128 << 10});
+  auto& input = CreateTape(GenerateValues(100000, 1));
+  auto& output = CreateTape({});
+  // a single thread runs a single job, which gets the whole budget
+  auto job_id = service.Submit(input, output);
+  auto queued_job_id = service.Submit(input, output);
+  ASSERT_EQ(service.GetStatus(queued_job_id).state,
+            ts::SortJobState::kQueued);
+  auto status = service.GetStatus(job_id);
+  if (status.state == ts::SortJobState::kRunning) {
+    ASSERT_EQ(status.granted_memory, kBudget);
+  }
+  service.Wait(job_id);
+  service.WaitAll();
+  ASSERT_EQ(service.GetStatus(queued_job_id).state, ts::SortJobState::kDone);
+}
+
+TEST_F(SortServiceData, FailedJob) {
+  ts::SortService service({2, ts::MemoryBudget{1 << 20}, 128 << 10});
+  auto& input = CreateTape(GenerateValues(1000, 2));
+  auto& output = CreateTape({});
+  // the temporary tapes need more than the job memory
+  class HungryTapeCreator : public ts::TempFileTapeCreator {
+   public:
+    size_t GetTapeMemoryUsage() const override { return 1 << 20; }
+  };
+  auto job_id =
+      service.Submit(input, output, std::make_unique<HungryTapeCreator>());
+  ASSERT_THROW(service.Wait(job_id), std::invalid_argument);
+  ASSERT_EQ(service.GetStatus(job_id).state, ts::SortJobState::kFailed);
+  ASSERT_THROW(service.GetStatus(job_id + 1), std::out_of_range);
+}
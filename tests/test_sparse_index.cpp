@@ -0,0 +1,173 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/sort/tape_sorter.h>
+#include <tape_sorter/sparse_index.h>
+
+namespace ts = tape_sorter;
+namespace fs = std::filesystem;
+
+class IndexedTape : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    fs::remove(GetTapePath());
+    fs::remove(ts::SparseIndex::GetSidecarPath(GetTapePath()));
+  }
+
+  static fs::path GetTapePath() {
+    return fs::current_path() / "indexed_tape";
+  }
+
+  // Sorted values with runs of duplicates
+  static std::vector<int> GenerateSortedValues(size_t values_number) {
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<int> distribution{-1000, 1000};
+    std::vector<int> values(values_number);
+    std::generate(values.begin(), values.end(),
+                  [&] { return distribution(generator); });
+    std::sort(values.begin(), values.end());
+    return values;
+  }
+
+  static void WriteIndexed(const std::vector<int>& values,
+                           ts::SparseIndex& index) {
+    ts::FileTape tape(GetTapePath());
+    ts::IndexingTape indexing_tape(tape, index);
+    for (auto value : values) {
+      indexing_tape.WriteForward(value);
+    }
+  }
+};
+
+TEST(SparseIndex, ZeroStride) {
+  ASSERT_THROW(ts::SparseIndex(0), std::invalid_argument);
+}
+
+TEST(SparseIndex, KeepsEveryStrideValue) {
+  ts::SparseIndex index(3);
+  for (int i = 0; i != 10; ++i) {
+    index.Add(i * 10);
+  }
+  ASSERT_EQ(index.GetValuesNumber(), 10);
+  const auto& entries = index.GetEntries();
+  ASSERT_EQ(entries.size(), 4);
+  ASSERT_EQ(entries[1].key, 30);
+  ASSERT_EQ(entries[1].position, 3);
+  ASSERT_EQ(entries[3].key, 90);
+  ASSERT_EQ(entries[3].position, 9);
+}
+
+TEST_F(IndexedTape, SaveAndLoad) {
+  ts::SparseIndex index(7);
+  for (int i = 0; i != 100; ++i) {
+    index.Add(i);
+  }
+  auto path = ts::SparseIndex::GetSidecarPath(GetTapePath());
+  index.Save(path);
+  auto loaded_index = ts::SparseIndex::Load(path);
+  ASSERT_EQ(loaded_index.GetStride(), 7);
+  ASSERT_EQ(loaded_index.GetValuesNumber(), 100);
+  ASSERT_EQ(loaded_index.GetEntries().size(), index.GetEntries().size());
+  ASSERT_EQ(loaded_index.GetEntries().back().key, 98);
+
+  // a tape is not an index
+  WriteIndexed({1, 2, 3}, index);
+  ASSERT_THROW(ts::SparseIndex::Load(GetTapePath()), std::runtime_error);
+}
+
+TEST_F(IndexedTape, LowerBound) {
+  constexpr const size_t kStride = 64;
+  auto values = GenerateSortedValues(10000);
+  ts::SparseIndex index(kStride);
+  WriteIndexed(values, index);
+  ts::FileTape tape(GetTapePath());
+  ts::IndexedTapeReader reader(tape, index);
+
+  for (int key = -1010; key <= 1010; key += 7) {
+    auto expected_position =
+        std::lower_bound(values.begin(), values.end(), key) - values.begin();
+    auto reads = tape.GetOperationCounts().reads;
+    ASSERT_EQ(reader.LowerBound(key), expected_position);
+    // the scan stays within a stride
+    ASSERT_LE(tape.GetOperationCounts().reads - reads, kStride + 1);
+    ASSERT_EQ(reader.Contains(key),
+              std::binary_search(values.begin(), values.end(), key));
+  }
+  ASSERT_GT(tape.GetOperationCounts().seeks, 0);
+}
+
+TEST_F(IndexedTape, ScanRange) {
+  auto values = GenerateSortedValues(5000);
+  ts::SparseIndex index(100);
+  WriteIndexed(values, index);
+  ts::FileTape tape(GetTapePath());
+  ts::IndexedTapeReader reader(tape, index);
+
+  std::vector<int> range;
+  auto values_number =
+      reader.ScanRange(-10, 25, [&range](int value) { range.push_back(value); });
+  std::vector<int> expected_range(
+      std::lower_bound(values.begin(), values.end(), -10),
+      std::upper_bound(values.begin(), values.end(), 25));
+  ASSERT_EQ(values_number, expected_range.size());
+  ASSERT_EQ(range, expected_range);
+  ASSERT_EQ(reader.ScanRange(2000, 3000, [](int) {}), 0);
+}
+
+TEST_F(IndexedTape, WrittenBySort) {
+  constexpr const size_t kValuesNumber = 3000;
+  auto input_path = fs::current_path() / "indexed_input_tape";
+  std::mt19937 generator{7};
+  {
+    ts::FileTape input_tape(input_path);
+    for (size_t i = 0; i != kValuesNumber; ++i) {
+      input_tape.WriteForward(static_cast<int>(generator() % 500));
+    }
+  }
+  ts::SortOptions options;
+  options.sparse_index = std::make_shared<ts::SparseIndex>(50);
+  {
+    ts::FileTape input_tape(input_path);
+    ts::FileTape output_tape(GetTapePath());
+    ts::TapeSorter(200, std::make_unique<ts::TempFileTapeCreator>(), options,
+                   std::greater<int>{})
+        .Sort(input_tape, output_tape);
+  }
+  fs::remove(input_path);
+  const auto& index = *options.sparse_index;
+  ASSERT_EQ(index.GetValuesNumber(), kValuesNumber);
+  ASSERT_EQ(index.GetEntries().size(), kValuesNumber / 50);
+
+  ts::FileTape tape(GetTapePath());
+  ts::IndexedTapeReader reader(tape, index, std::greater<int>{});
+  size_t values_number = 0;
+  reader.ScanRange(300, 200, [&values_number](int value) {
+    ASSERT_LE(value, 300);
+    ASSERT_GE(value, 200);
+    ++values_number;
+  });
+  ASSERT_GT(values_number, 0);
+  auto position = reader.LowerBound(250);
+  tape.Rewind();
+  for (uint64_t i = 0; i != position; ++i) {
+    ASSERT_GT(tape.ReadForward().value(), 250);
+  }
+  ASSERT_LE(tape.Read().value(), 250);
+}
@@ -0,0 +1,184 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/sort/tape_sorter.h>
+#include <tape_sorter/stream_tape.h>
+
+namespace ts = tape_sorter;
+namespace fs = std::filesystem;
+
+class TestStreamTape : public ::testing::Test {
+  static constexpr const auto kTempTapeFilename = "stream_tape_data";
+
+ protected:
+  void TearDown() override { fs::remove(GetTempTapePath()); }
+
+  fs::path GetTempTapePath() const {
+    return fs::current_path() / kTempTapeFilename;
+  }
+
+  std::string ReadContent() {
+    std::ifstream file(GetTempTapePath(), std::ifstream::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  // Returns the read end of a pipe fed with the content by a writer thread
+  int Pipe(std::string content) {
+    int fds[2];
+    if (::pipe(fds) != 0) {
+      throw std::runtime_error("Failed to create a pipe");
+    }
+    writer_ = std::thread([fd = fds[1], content = std::move(content)] {
+      ::write(fd, content.data(), content.size());
+      ::close(fd);
+    });
+    read_fd_ = fds[0];
+    return read_fd_;
+  }
+
+  void ClosePipe() {
+    writer_.join();
+    ::close(read_fd_);
+  }
+
+  static std::vector<int> ReadAll(ts::ITape& tape) {
+    std::vector<int> values;
+    while (auto value = tape.ReadForward()) {
+      values.push_back(value.value());
+    }
+    return values;
+  }
+
+ private:
+  std::thread writer_;
+  int read_fd_{-1};
+};
+
+TEST_F(TestStreamTape, BinaryInput) {
+  std::vector<int> expected(10000);
+  std::iota(expected.begin(), expected.end(), -5000);
+  std::string content(reinterpret_cast<const char*>(expected.data()),
+                      expected.size() * sizeof(int));
+
+  ts::InputStreamTape tape(Pipe(content), ts::StreamFormat::kBinary, 100);
+  ASSERT_EQ(ReadAll(tape), expected);
+  ASSERT_FALSE(tape.Read());
+  ClosePipe();
+}
+
+TEST_F(TestStreamTape, TextInput) {
+  std::vector<int> expected(10000);
+  std::iota(expected.begin(), expected.end(), -5000);
+  std::stringstream content;
+  for (auto value : expected) {
+    content << "  " << value << (value % 3 == 0 ? "\r\n" : "\t");
+  }
+
+  // A small buffer makes the numbers cross the buffer boundaries
+  ts::InputStreamTape tape(Pipe(content.str()), ts::StreamFormat::kText, 1);
+  ASSERT_EQ(ReadAll(tape), expected);
+  ClosePipe();
+}
+
+TEST_F(TestStreamTape, TextInputWithoutTrailingNewline) {
+  ts::InputStreamTape tape(Pipe("1\n-2\n2147483647"), ts::StreamFormat::kText);
+  ASSERT_EQ(ReadAll(tape), (std::vector<int>{1, -2, 2147483647}));
+  ClosePipe();
+}
+
+TEST_F(TestStreamTape, ReadDoesNotMove) {
+  ts::InputStreamTape tape(Pipe("1 2"), ts::StreamFormat::kText);
+  ASSERT_EQ(tape.Read().value(), 1);
+  ASSERT_EQ(tape.Read().value(), 1);
+  ASSERT_TRUE(tape.MoveForward());
+  ASSERT_EQ(tape.Read().value(), 2);
+  ASSERT_TRUE(tape.MoveForward());
+  ASSERT_FALSE(tape.MoveForward());
+  ASSERT_FALSE(tape.MoveBackward());
+  ClosePipe();
+}
+
+TEST_F(TestStreamTape, InvalidTextInput) {
+  ts::InputStreamTape tape(Pipe("1 a2 3"), ts::StreamFormat::kText);
+  ASSERT_EQ(tape.ReadForward().value(), 1);
+  ASSERT_THROW(tape.ReadForward(), std::invalid_argument);
+  ClosePipe();
+}
+
+TEST_F(TestStreamTape, TruncatedBinaryInput) {
+  ts::InputStreamTape tape(Pipe("12345"), ts::StreamFormat::kBinary);
+  ASSERT_TRUE(tape.ReadForward());
+  ASSERT_THROW(tape.ReadForward(), std::runtime_error);
+  ClosePipe();
+}
+
+TEST_F(TestStreamTape, BinaryOutput) {
+  std::vector<int> expected(10000);
+  std::iota(expected.begin(), expected.end(), -5000);
+  {
+    ts::OutputStreamTape tape(GetTempTapePath(), ts::StreamFormat::kBinary,
+                              100);
+    for (auto value : expected) {
+      tape.WriteForward(value);
+    }
+  }
+  ts::InputStreamTape tape(GetTempTapePath());
+  ASSERT_EQ(ReadAll(tape), expected);
+}
+
+TEST_F(TestStreamTape, TextOutput) {
+  ts::OutputStreamTape tape(GetTempTapePath(), ts::StreamFormat::kText);
+  tape.WriteForward(1);
+  tape.Write(-2);
+  tape.MoveForward();
+  // not moved past, so it is not emitted
+  tape.Write(3);
+  tape.Flush();
+  ASSERT_EQ(ReadContent(), "1\n-2\n");
+  ASSERT_FALSE(tape.Read());
+}
+
+TEST_F(TestStreamTape, SortTextPipe) {
+  std::vector<int> numbers(1000);
+  std::iota(numbers.rbegin(), numbers.rend(), 0);
+  std::stringstream content;
+  for (auto value : numbers) {
+    content << value << '\n';
+  }
+  {
+    ts::InputStreamTape input_tape(Pipe(content.str()),
+                                   ts::StreamFormat::kText);
+    ts::OutputStreamTape output_tape(GetTempTapePath(),
+                                     ts::StreamFormat::kText);
+    ts::TapeSorter(100).Sort(input_tape, output_tape);
+    ClosePipe();
+  }
+  std::sort(numbers.begin(), numbers.end());
+  std::stringstream expected;
+  for (auto value : numbers) {
+    expected << value << '\n';
+  }
+  ASSERT_EQ(ReadContent(), expected.str());
+}
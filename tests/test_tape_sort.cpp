@@ -13,10 +13,14 @@
 //   limitations under the License.
 
 #include <filesystem>
+#include <limits>
 #include <random>
 
 #include <gtest/gtest.h>
+#include <tape_sorter/sort/drive_pool.h>
 #include <tape_sorter/sort/tape_sorter.h>
+#include <tape_sorter/sort/temp_file_tape_creator.h>
+#include <tape_sorter/stream_tape.h>
 
 namespace ts = tape_sorter;
 namespace fs = std::filesystem;
@@ -36,6 +40,133 @@ std::vector<int> GenerateRandomVector(size_t size, int min_value = -1000,
   return random_integers;
 }
 
+// Corrupts the value written at the given position of every tape it creates
+class CorruptingTapeCreator : public ts::ITempTapeCreator {
+  class CorruptingTape : public ts::ITape {
+   public:
+    CorruptingTape(std::unique_ptr<ts::ITape> tape, size_t position, int delta)
+        : tape_(std::move(tape)), position_(position), delta_(delta) {}
+
+    std::optional<int> Read() override { return tape_->Read(); }
+
+    void Write(int value) override { tape_->Write(value); }
+
+    bool MoveForward() override { return tape_->MoveForward(); }
+
+    bool MoveBackward() override { return tape_->MoveBackward(); }
+
+    void Rewind() override { tape_->Rewind(); }
+
+    void WriteForward(int value) override {
+      tape_->WriteForward(written_++ == position_ ? value + delta_ : value);
+    }
+
+   private:
+    std::unique_ptr<ts::ITape> tape_;
+    size_t position_;
+    int delta_;
+    size_t written_{0};
+  };
+
+ public:
+  CorruptingTapeCreator(size_t position, int delta)
+      : position_(position), delta_(delta) {}
+
+  std::unique_ptr<ts::ITape> Create() override {
+    return std::make_unique<CorruptingTape>(creator_.Create(), position_,
+                                            delta_);
+  }
+
+ private:
+  ts::TempFileTapeCreator creator_;
+  size_t position_;
+  int delta_;
+};
+
+TEST(MultisetChecksum, OrderIndependent) {
+  // distinct values, so that changing one changes the multiset
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), -500);
+  std::shuffle(values.begin(), values.end(), std::mt19937{});
+  ts::MultisetChecksum checksum;
+  for (auto value : values) {
+    checksum.Add(value);
+  }
+  std::sort(values.begin(), values.end());
+  ts::MultisetChecksum sorted_checksum;
+  for (auto value : values) {
+    sorted_checksum.Add(value);
+  }
+  ASSERT_EQ(checksum, sorted_checksum);
+  ASSERT_EQ(sorted_checksum.count, values.size());
+  ASSERT_EQ(sorted_checksum.min, values.front());
+  ASSERT_EQ(sorted_checksum.max, values.back());
+
+  // the same count, min and max, but a different multiset
+  values[1] = values[2];
+  ts::MultisetChecksum changed_checksum;
+  for (auto value : values) {
+    changed_checksum.Add(value);
+  }
+  ASSERT_NE(changed_checksum, sorted_checksum);
+}
+
+// Reports a fixed memory usage of its tapes and tracks how many of them exist
+// at once
+class TrackingTapeCreator : public ts::ITempTapeCreator {
+  class TrackedTape : public ts::ITape {
+   public:
+    TrackedTape(std::unique_ptr<ts::ITape> tape, size_t& live_tapes)
+        : tape_(std::move(tape)), live_tapes_(live_tapes) {
+      ++live_tapes_;
+    }
+
+    ~TrackedTape() override { --live_tapes_; }
+
+    std::optional<int> Read() override { return tape_->Read(); }
+
+    void Write(int value) override { tape_->Write(value); }
+
+    bool MoveForward() override { return tape_->MoveForward(); }
+
+    bool MoveBackward() override { return tape_->MoveBackward(); }
+
+    void Rewind() override { tape_->Rewind(); }
+
+   private:
+    std::unique_ptr<ts::ITape> tape_;
+    size_t& live_tapes_;
+  };
+
+ public:
+  explicit TrackingTapeCreator(size_t tape_memory_usage)
+      : tape_memory_usage_(tape_memory_usage) {}
+
+  std::unique_ptr<ts::ITape> Create() override {
+    auto tape = std::make_unique<TrackedTape>(creator_.Create(), live_tapes_);
+    max_live_tapes_ = std::max(max_live_tapes_, live_tapes_);
+    return tape;
+  }
+
+  size_t GetTapeMemoryUsage() const override { return tape_memory_usage_; }
+
+  size_t GetMaxLiveTapes() const { return max_live_tapes_; }
+
+  const ts::TapeOperationCounts& GetOperationCounts() const {
+    return creator_.GetOperationCounts();
+  }
+
+  size_t GetCreatedTapesNumber() const {
+    return creator_.GetCreatedTapesNumber();
+  }
+
+ private:
+  ts::TempFileTapeCreator creator_;
+  size_t tape_memory_usage_;
+  size_t live_tapes_{0};
+  size_t max_live_tapes_{0};
+};
+
 class SortData : public ::testing::Test {
   static constexpr const auto kTempTapeFilename = "test_tape";
 
@@ -63,7 +194,11 @@ class SortData : public ::testing::Test {
   ts::FileTape& GetOutputTape() { return *output_tape_; }
 
   std::vector<int> ReadNumbersFromOutputTape() {
-    std::ifstream file(GetOutputTempTapePath());
+    return ReadNumbersFromFile(GetOutputTempTapePath());
+  }
+
+  static std::vector<int> ReadNumbersFromFile(const fs::path& path) {
+    std::ifstream file(path);
     std::vector<int> content;
 
     int value;
@@ -100,6 +235,819 @@ TEST_F(SortData, Decreasing) {
   ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
 }
 
+TEST_F(SortData, OperationCounts) {
+  constexpr const size_t kNumbers = 1000;
+  constexpr const size_t kBufferSize = 64;
+  constexpr const size_t kRuns = (kNumbers + kBufferSize - 1) / kBufferSize;
+  std::vector<int> expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  auto& input_tape = GetInputTape();
+  auto& output_tape = GetOutputTape();
+  auto temp_tape_creator = std::make_unique<ts::TempFileTapeCreator>();
+  const auto& temp_tapes = *temp_tape_creator;
+  auto sorter = ts::TapeSorter(kBufferSize, std::move(temp_tape_creator));
+
+  sorter.Sort(input_tape, output_tape);
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+
+  // input: one read and one move per element, the end is probed once
+  const auto& input_counts = input_tape.GetOperationCounts();
+  ASSERT_EQ(input_counts.reads, kNumbers + 1);
+  ASSERT_EQ(input_counts.moves, kNumbers);
+  ASSERT_EQ(input_counts.writes, 0);
+  // output: one write and one move per element
+  const auto& output_counts = output_tape.GetOperationCounts();
+  ASSERT_EQ(output_counts.writes, kNumbers);
+  ASSERT_EQ(output_counts.moves, kNumbers);
+  ASSERT_EQ(output_counts.reads, 0);
+  // runs: every element is written and read once, each run pays one move to
+  // step back onto its last element and one read hitting its beginning
+  ASSERT_EQ(temp_tapes.GetCreatedTapesNumber(), kRuns);
+  const auto& temp_counts = temp_tapes.GetOperationCounts();
+  ASSERT_EQ(temp_counts.writes, kNumbers);
+  ASSERT_EQ(temp_counts.reads, kNumbers + kRuns);
+  ASSERT_EQ(temp_counts.moves, 2 * kNumbers + kRuns);
+  ASSERT_EQ(temp_counts.backward_moves, kNumbers + kRuns);
+  ASSERT_EQ(temp_counts.rewinds, 0);
+}
+
+TEST_F(SortData, ForwardLayoutOperationCounts) {
+  constexpr const size_t kNumbers = 1000;
+  constexpr const size_t kBufferSize = 64;
+  constexpr const size_t kRuns = (kNumbers + kBufferSize - 1) / kBufferSize;
+  std::vector<int> expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  auto& input_tape = GetInputTape();
+  auto& output_tape = GetOutputTape();
+  auto temp_tape_creator = std::make_unique<ts::TempFileTapeCreator>();
+  const auto& temp_tapes = *temp_tape_creator;
+  ts::SortOptions options;
+  options.run_layout = ts::RunLayout::kForward;
+  auto sorter =
+      ts::TapeSorter(kBufferSize, std::move(temp_tape_creator), options);
+
+  sorter.Sort(input_tape, output_tape);
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+
+  // runs are written, rewound once and read streaming forward
+  ASSERT_EQ(temp_tapes.GetCreatedTapesNumber(), kRuns);
+  const auto& temp_counts = temp_tapes.GetOperationCounts();
+  ASSERT_EQ(temp_counts.writes, kNumbers);
+  ASSERT_EQ(temp_counts.reads, kNumbers + kRuns);
+  ASSERT_EQ(temp_counts.moves, 2 * kNumbers);
+  ASSERT_EQ(temp_counts.backward_moves, 0);
+  ASSERT_EQ(temp_counts.rewinds, kRuns);
+}
+
+TEST_F(SortData, Verify) {
+  std::vector<int> expected_numbers = GenerateRandomVector(1000);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.run_layout = ts::RunLayout::kForward;
+  options.verify = true;
+
+  ts::TapeSorter(100, std::make_unique<ts::TempFileTapeCreator>(), options)
+      .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+}
+
+TEST_F(SortData, VerifyDetectsChangedValue) {
+  // the last value of a run stays in order, but changes the multiset
+  std::vector<int> numbers(1000);
+  std::iota(numbers.begin(), numbers.end(), 0);
+  WriteNumbersToInputTape(numbers);
+  ts::SortOptions options;
+  options.run_layout = ts::RunLayout::kForward;
+  options.verify = true;
+
+  ASSERT_THROW(
+      ts::TapeSorter(100, std::make_unique<CorruptingTapeCreator>(99, 1),
+                     options)
+          .Sort(GetInputTape(), GetOutputTape()),
+      ts::SortVerificationError);
+}
+
+TEST_F(SortData, VerifyDetectsDisorder) {
+  std::vector<int> numbers(1000);
+  std::iota(numbers.begin(), numbers.end(), 0);
+  WriteNumbersToInputTape(numbers);
+  ts::SortOptions options;
+  options.run_layout = ts::RunLayout::kForward;
+  options.verify = true;
+
+  ASSERT_THROW(
+      ts::TapeSorter(100, std::make_unique<CorruptingTapeCreator>(50, 1000),
+                     options)
+          .Sort(GetInputTape(), GetOutputTape()),
+      ts::SortVerificationError);
+}
+
+TEST_F(SortData, ReusesArenaBuffers) {
+  std::vector<int> expected_numbers = GenerateRandomVector(100000);
+  WriteNumbersToInputTape(expected_numbers);
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ts::SortOptions options;
+  options.buffer_arena = std::make_shared<ts::BufferArena>();
+  const auto& buffer_arena = options.buffer_arena;
+  auto sorter = ts::TapeSorter(
+      20000,
+      std::make_unique<ts::TempFileTapeCreator>(ts::TapeDelayConfig{},
+                                                ts::FileTapeBackend::kDirect),
+      options);
+
+  sorter.Sort(GetInputTape(), GetOutputTape());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  auto maps_number = buffer_arena->GetMapsNumber();
+
+  // blocks and the buffers of the temporary tapes come from the first sort
+  GetInputTape().Rewind();
+  GetOutputTape().Rewind();
+  sorter.Sort(GetInputTape(), GetOutputTape());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(buffer_arena->GetMapsNumber(), maps_number);
+}
+
+TEST_F(SortData, Threads) {
+  constexpr const size_t kNumbers = 250000;
+  constexpr const size_t kBufferSize = 100000;
+  std::vector<int> expected_numbers =
+      GenerateRandomVector(kNumbers, std::numeric_limits<int>::min(),
+                           std::numeric_limits<int>::max());
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  // the parts do not pair up evenly
+  options.threads_number = 3;
+
+  auto statistics =
+      ts::TapeSorter(kBufferSize, std::make_unique<ts::TempFileTapeCreator>(),
+                     options)
+          .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.values_number, kNumbers);
+  ASSERT_EQ(statistics.runs_number, 3);
+  ASSERT_EQ(statistics.early_merges_number, 0);
+}
+
+TEST_F(SortData, ThreadPool) {
+  constexpr const size_t kNumbers = 250000;
+  constexpr const size_t kBufferSize = 100000;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.threads_number = 4;
+  options.thread_pool = std::make_shared<ts::ThreadPool>(2);
+  options.progress = std::make_shared<ts::SortProgress>();
+
+  ts::TapeSorter(kBufferSize, std::make_unique<ts::TempFileTapeCreator>(),
+                 options)
+      .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(options.progress->values_read, kNumbers);
+  ASSERT_EQ(options.progress->values_written, kNumbers);
+}
+
+TEST_F(SortData, WriteBehind) {
+  constexpr const size_t kNumbers = 100000;
+  constexpr const size_t kBufferSize = 10000;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.write_behind_buffer_size = 4096;
+  options.verify = true;
+  options.progress = std::make_shared<ts::SortProgress>();
+
+  ts::TapeSorter(kBufferSize, std::make_unique<ts::TempFileTapeCreator>(),
+                 options)
+      .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(options.progress->values_written, kNumbers);
+}
+
+TEST_F(SortData, WriteBehindBufferTakenFromBudget) {
+  constexpr const size_t kNumbers = 100000;
+  constexpr const size_t kBudget = 256 << 10;
+  // rounded up to 16384 values
+  constexpr const size_t kWriteBehindBufferSize = 10000;
+  WriteNumbersToInputTape(GenerateRandomVector(kNumbers));
+  auto first_block_size = [this](const ts::SortOptions& options) {
+    GetInputTape().Rewind();
+    GetOutputTape().Rewind();
+    auto statistics =
+        ts::TapeSorter(ts::MemoryBudget{kBudget},
+                       std::make_unique<ts::TempFileTapeCreator>(), options)
+            .Sort(GetInputTape(), GetOutputTape());
+    return statistics.schedule.front().values_number;
+  };
+
+  ts::SortOptions options;
+  auto block_size = first_block_size(options);
+  options.write_behind_buffer_size = kWriteBehindBufferSize;
+  ASSERT_EQ(first_block_size(options), block_size - 16384);
+
+  options.write_behind_buffer_size = kBudget / sizeof(int) / 2;
+  ASSERT_THROW(
+      ts::TapeSorter(ts::MemoryBudget{kBudget},
+                     std::make_unique<ts::TempFileTapeCreator>(), options),
+      std::invalid_argument);
+}
+
+class SortFramedData : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    fs::remove(GetInputPath());
+    fs::remove(GetOutputPath());
+  }
+
+  static fs::path GetInputPath() {
+    return fs::current_path() / "framed_input_tape";
+  }
+
+  static fs::path GetOutputPath() {
+    return fs::current_path() / "framed_output_tape";
+  }
+
+  static ts::FileTape CreateTape(const fs::path& path) {
+    return ts::FileTape(path, {}, ts::FileTapeBackend::kStream,
+                        std::make_shared<ts::TapeOperationCounts>(), nullptr,
+                        ts::FileTapeFormat::kFramed);
+  }
+
+  static void WriteInput(const std::vector<int>& values) {
+    auto tape = CreateTape(GetInputPath());
+    for (auto value : values) {
+      tape.WriteForward(value);
+    }
+  }
+
+  static std::vector<int> ReadOutput() {
+    ts::FileTape tape(GetOutputPath());
+    std::vector<int> values;
+    while (auto value = tape.ReadForward()) {
+      values.push_back(value.value());
+    }
+    return values;
+  }
+
+  // Sorts the input into the output and checks the statistics of the output
+  template <typename Comparator = std::less<int>>
+  ts::SortStatistics Sort(size_t buffer_size, size_t expected_temp_tapes,
+                          Comparator comparator = {},
+                          ts::SortEngine engine = ts::SortEngine::kMerge) {
+    auto input_tape = CreateTape(GetInputPath());
+    auto temp_tape_creator = std::make_unique<ts::TempFileTapeCreator>();
+    const auto& temp_tapes = *temp_tape_creator;
+    ts::SortOptions options;
+    options.verify = true;
+    options.engine = engine;
+    ts::TapeSorter sorter(buffer_size, std::move(temp_tape_creator), options,
+                          comparator);
+    ts::SortStatistics statistics;
+    fs::remove(GetOutputPath());
+    {
+      auto output_tape = CreateTape(GetOutputPath());
+      statistics = sorter.Sort(input_tape, output_tape);
+      auto metadata = output_tape.GetMetadata().value();
+      EXPECT_EQ(metadata.values_number, statistics.values_number);
+    }
+    EXPECT_EQ(temp_tapes.GetCreatedTapesNumber(), expected_temp_tapes);
+    return statistics;
+  }
+};
+
+TEST_F(SortFramedData, SortedInputIsCopied) {
+  std::vector<int> values(1000);
+  std::iota(values.begin(), values.end(), 0);
+  WriteInput(values);
+
+  auto statistics = Sort(10, 0);
+  ASSERT_EQ(statistics.runs_number, 0);
+  ASSERT_EQ(statistics.schedule.size(), 1);
+  ASSERT_EQ(statistics.schedule.front().kind, ts::SortStepKind::kCopy);
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(ts::FileTape(GetOutputPath()).GetMetadata()->sort_order,
+            ts::SortOrder::kAscending);
+
+  // not in the order of the comparator
+  statistics = Sort(10, 100, std::greater<int>{});
+  std::reverse(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(statistics.runs_number, 100);
+}
+
+TEST_F(SortFramedData, FittingInputIsSortedInMemory) {
+  auto values = GenerateRandomVector(1000);
+  WriteInput(values);
+
+  auto statistics = Sort(1000, 0);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(statistics.runs_number, 1);
+  ASSERT_EQ(statistics.schedule.size(), 1);
+  ASSERT_EQ(statistics.schedule.front().kind, ts::SortStepKind::kRun);
+
+  // one value more takes runs
+  values.push_back(0);
+  WriteInput(values);
+  statistics = Sort(1000, 2);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+}
+
+TEST_F(SortFramedData, CountingTakesKeyRangeFromMetadata) {
+  // the block counts 50 keys a pass, the input is read twice
+  auto values = GenerateRandomVector(1000, 0, 99);
+  values.front() = 0;
+  values.back() = 99;
+  WriteInput(values);
+
+  auto statistics = Sort(100, 0, std::less<int>{}, ts::SortEngine::kCounting);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kCounting);
+  ASSERT_EQ(statistics.schedule.size(), 2);
+  ASSERT_EQ(statistics.schedule.front().kind, ts::SortStepKind::kCount);
+}
+
+TEST_F(SortFramedData, CountingFromHead) {
+  constexpr const size_t kSkipped = 100;
+  auto values = GenerateRandomVector(1000, 0, 99);
+  WriteInput(values);
+  auto input_tape = CreateTape(GetInputPath());
+  for (size_t i = 0; i != kSkipped; ++i) {
+    input_tape.MoveForward();
+  }
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  ts::TapeSorter sorter(100, std::make_unique<ts::TempFileTapeCreator>(),
+                        options);
+
+  // the second pass starts from the head, not from the first value
+  ts::SortStatistics statistics;
+  {
+    auto output_tape = CreateTape(GetOutputPath());
+    statistics = sorter.Sort(input_tape, output_tape);
+  }
+  values.erase(values.begin(), values.begin() + kSkipped);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(statistics.schedule.size(), 2);
+  // one locate back to the head instead of a move a value
+  const auto& input_counts = input_tape.GetOperationCounts();
+  ASSERT_EQ(input_counts.seeks, 1);
+  ASSERT_EQ(input_counts.backward_moves, 0);
+}
+
+TEST_F(SortFramedData, CountingInPartitions) {
+  // the block counts 50 keys a pass, three passes read no more than the
+  // merge of ten runs writes and reads
+  auto values = GenerateRandomVector(1000, 0, 149);
+  values.front() = 0;
+  values.back() = 149;
+  WriteInput(values);
+
+  auto statistics = Sort(100, 0, std::less<int>{}, ts::SortEngine::kCounting);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kCounting);
+  ASSERT_EQ(statistics.schedule.size(), 3);
+  ASSERT_TRUE(std::all_of(statistics.schedule.begin(),
+                          statistics.schedule.end(), [](const auto& step) {
+                            return step.kind == ts::SortStepKind::kCount;
+                          }));
+
+  // a fourth pass costs more than the merge
+  values = GenerateRandomVector(1000, 0, 199);
+  values.front() = 0;
+  values.back() = 199;
+  WriteInput(values);
+  statistics = Sort(100, 10, std::less<int>{}, ts::SortEngine::kCounting);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kMerge);
+
+  // unless the merge is not allowed
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  options.strict_engine = true;
+  auto input_tape = CreateTape(GetInputPath());
+  auto output_tape = CreateTape(GetOutputPath());
+  ASSERT_THROW(
+      ts::TapeSorter(100, std::make_unique<ts::TempFileTapeCreator>(), options)
+          .Sort(input_tape, output_tape),
+      std::invalid_argument);
+}
+
+TEST_F(SortFramedData, CountingWideRange) {
+  // the keys take many passes, the merge sorts the input instead
+  auto values = GenerateRandomVector(1000, -1000000, 1000000);
+  WriteInput(values);
+
+  auto statistics =
+      Sort(100, 10, std::less<int>{}, ts::SortEngine::kCounting);
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(ReadOutput(), values);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kMerge);
+  ASSERT_EQ(statistics.runs_number, 10);
+}
+
+TEST_F(SortData, Descending) {
+  constexpr const size_t kNumbers = 1000;
+  constexpr const size_t kBufferSize = 64;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.verify = true;
+
+  ts::TapeSorter(kBufferSize, std::make_unique<ts::TempFileTapeCreator>(),
+                 options, std::greater<int>{})
+      .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end(),
+            std::greater<int>{});
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+}
+
+// Orders the values by their thousands only
+struct ThousandsComparator {
+  bool operator()(int lhs, int rhs) const { return lhs / 1000 < rhs / 1000; }
+};
+
+class SortDataStableParametrized
+    : public SortData,
+      public testing::WithParamInterface<ts::RunLayout> {};
+
+TEST_P(SortDataStableParametrized, KeepsInputOrder) {
+  constexpr const int kNumbers = 1000;
+  constexpr const size_t kBufferSize = 10;
+  // the thousands are the key, the rest is the position in the input
+  std::mt19937 generator(kNumbers);
+  std::uniform_int_distribution<> distribution(0, 20);
+  std::vector<int> numbers;
+  for (int i = 0; i != kNumbers; ++i) {
+    numbers.push_back(distribution(generator) * 1000 + i);
+  }
+  WriteNumbersToInputTape(numbers);
+  ts::SortOptions options;
+  options.run_layout = GetParam();
+  options.verify = true;
+
+  // few drives force merges in several passes
+  auto statistics =
+      ts::TapeSorter<ThousandsComparator, ts::SortStability::kStable>(
+          kBufferSize,
+          std::make_unique<ts::DrivePool>(
+              std::make_unique<ts::TempFileTapeCreator>(),
+              ts::DrivePoolConfig{3}),
+          options)
+          .Sort(GetInputTape(), GetOutputTape());
+  ASSERT_GT(statistics.early_merges_number, 0);
+  std::sort(numbers.begin(), numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), numbers);
+}
+
+INSTANTIATE_TEST_SUITE_P(Sort, SortDataStableParametrized,
+                         testing::Values(ts::RunLayout::kBackward,
+                                         ts::RunLayout::kForward));
+
+TEST_F(SortData, StableBlocks) {
+  // slices merged in several passes, and blocks sorted by an odd number of
+  // threads
+  constexpr const int kNumbers = 140000;
+  constexpr const size_t kBufferSize = 70000;
+  std::mt19937 generator(kNumbers);
+  std::uniform_int_distribution<> distribution(0, 20);
+  std::vector<int> numbers;
+  for (int i = 0; i != kNumbers; ++i) {
+    numbers.push_back(distribution(generator) * 1000000 + i);
+  }
+  WriteNumbersToInputTape(numbers);
+  ts::SortOptions options;
+  options.threads_number = 3;
+  options.verify = true;
+
+  ts::TapeSorter<ThousandsComparator, ts::SortStability::kStable>(
+      kBufferSize, std::make_unique<ts::TempFileTapeCreator>(), options)
+      .Sort(GetInputTape(), GetOutputTape());
+  std::sort(numbers.begin(), numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), numbers);
+}
+
+TEST_F(SortData, Distribution) {
+  constexpr const size_t kNumbers = 20000;
+  constexpr const size_t kBufferSize = 1000;
+  std::mt19937 generator(kNumbers);
+  std::vector<int> expected_numbers(kNumbers);
+  for (auto& number : expected_numbers) {
+    number = static_cast<int>(generator());
+  }
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kDistribution;
+  options.verify = true;
+  auto temp_tape_creator = std::make_unique<ts::TempFileTapeCreator>();
+  const auto& temp_tapes = *temp_tape_creator;
+
+  ts::TapeSorter sorter(kBufferSize, std::move(temp_tape_creator), options);
+
+  auto statistics = sorter.Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.values_number, kNumbers);
+  ASSERT_EQ(statistics.schedule.front().kind, ts::SortStepKind::kScatter);
+  // every bucket fits a block, so each value is written and read once
+  ASSERT_EQ(statistics.runs_number, temp_tapes.GetCreatedTapesNumber());
+  ASSERT_EQ(statistics.schedule.size(), statistics.runs_number + 1);
+  const auto& temp_counts = temp_tapes.GetOperationCounts();
+  ASSERT_EQ(temp_counts.writes, kNumbers);
+  ASSERT_EQ(temp_counts.reads, kNumbers);
+  ASSERT_EQ(temp_counts.backward_moves, 0);
+}
+
+TEST_F(SortData, DistributionOversizedBucket) {
+  constexpr const size_t kNumbers = 10000;
+  constexpr const size_t kBufferSize = 500;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  // most values fall into one bucket
+  for (size_t i = 0; i != kNumbers; i += 5) {
+    std::fill_n(expected_numbers.begin() + i, 4, 7);
+  }
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kDistribution;
+  options.verify = true;
+
+  auto statistics =
+      ts::TapeSorter(kBufferSize, std::make_unique<ts::TempFileTapeCreator>(),
+                     options)
+          .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_TRUE(std::any_of(statistics.schedule.begin(),
+                          statistics.schedule.end(), [](const auto& step) {
+                            return step.kind == ts::SortStepKind::kFinalMerge;
+                          }));
+}
+
+TEST_F(SortData, DistributionOfUnknownLength) {
+  constexpr const size_t kNumbers = 128000;
+  constexpr const size_t kBufferSize = 500;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kDistribution;
+  options.verify = true;
+  auto temp_tape_creator = std::make_unique<ts::TempFileTapeCreator>();
+  const auto& temp_tapes = *temp_tape_creator;
+  ts::TapeSorter sorter(kBufferSize, std::move(temp_tape_creator), options);
+
+  // the default buckets outgrow a block and are distributed once more
+  auto statistics = sorter.Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.values_number, kNumbers);
+  ASSERT_GT(std::count_if(statistics.schedule.begin(),
+                          statistics.schedule.end(),
+                          [](const auto& step) {
+                            return step.kind == ts::SortStepKind::kScatter;
+                          }),
+            1);
+  ASSERT_EQ(statistics.early_merges_number, 0);
+  // each value is scattered twice, a few are sorted by runs
+  ASSERT_LT(temp_tapes.GetOperationCounts().writes,
+            2 * kNumbers + kNumbers / 10);
+}
+
+TEST_F(SortData, DistributionOfUnknownLengthWithinBudget) {
+  constexpr const size_t kNumbers = 200000;
+  constexpr const size_t kMemoryBudget = 256 << 10;
+  constexpr const size_t kTapeMemoryUsage = 8 << 10;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  auto temp_tape_creator =
+      std::make_unique<TrackingTapeCreator>(kTapeMemoryUsage);
+  const auto& temp_tapes = *temp_tape_creator;
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kDistribution;
+  ts::TapeSorter sorter(ts::MemoryBudget{kMemoryBudget},
+                        std::move(temp_tape_creator), options);
+
+  // the buckets take the memory of the runs, and each of them fits a block
+  auto statistics = sorter.Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.schedule.size(), statistics.runs_number + 1);
+  ASSERT_EQ(temp_tapes.GetOperationCounts().writes, kNumbers);
+  ASSERT_LE(temp_tapes.GetMaxLiveTapes() * kTapeMemoryUsage,
+            kMemoryBudget / 2);
+}
+
+TEST_F(SortData, DistributionOversizedBucketWithinBudget) {
+  constexpr const size_t kNumbers = 200000;
+  constexpr const size_t kMemoryBudget = 128 << 10;
+  constexpr const size_t kTapeMemoryUsage = 8 << 10;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  // most values fall into one bucket
+  for (size_t i = 0; i != kNumbers; i += 5) {
+    std::fill_n(expected_numbers.begin() + i, 4, 7);
+  }
+  WriteNumbersToInputTape(expected_numbers);
+  auto temp_tape_creator =
+      std::make_unique<TrackingTapeCreator>(kTapeMemoryUsage);
+  const auto& temp_tapes = *temp_tape_creator;
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kDistribution;
+  ts::TapeSorter sorter(ts::MemoryBudget{kMemoryBudget},
+                        std::move(temp_tape_creator), options);
+
+  auto statistics = sorter.Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_GT(statistics.early_merges_number, 0);
+  // the runs of the oversized bucket share the budget with the open buckets
+  ASSERT_LE(temp_tapes.GetMaxLiveTapes() * kTapeMemoryUsage,
+            kMemoryBudget / 2);
+}
+
+TEST_F(SortData, DistributionStable) {
+  constexpr const int kNumbers = 1000;
+  constexpr const size_t kBufferSize = 10;
+  std::mt19937 generator(kNumbers);
+  std::uniform_int_distribution<> distribution(0, 20);
+  std::vector<int> numbers;
+  for (int i = 0; i != kNumbers; ++i) {
+    numbers.push_back(distribution(generator) * 1000 + i);
+  }
+  WriteNumbersToInputTape(numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kDistribution;
+
+  // two buckets on three drives, both sorted by runs
+  ts::TapeSorter<ThousandsComparator, ts::SortStability::kStable>(
+      kBufferSize,
+      std::make_unique<ts::DrivePool>(
+          std::make_unique<ts::TempFileTapeCreator>(), ts::DrivePoolConfig{3}),
+      options)
+      .Sort(GetInputTape(), GetOutputTape());
+  std::sort(numbers.begin(), numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), numbers);
+}
+
+TEST_F(SortData, Counting) {
+  constexpr const size_t kNumbers = 20000;
+  // a quarter of the block reads the input, the rest counts 500 keys
+  constexpr const size_t kBufferSize = 1000;
+  std::mt19937 generator(kNumbers);
+  std::uniform_int_distribution<> distribution(0, 499);
+  std::vector<int> expected_numbers(kNumbers);
+  for (auto& number : expected_numbers) {
+    number = distribution(generator);
+  }
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  options.key_range = ts::KeyRange{0, 499};
+  options.verify = true;
+  auto temp_tape_creator = std::make_unique<ts::TempFileTapeCreator>();
+  const auto& temp_tapes = *temp_tape_creator;
+  ts::TapeSorter sorter(kBufferSize, std::move(temp_tape_creator), options);
+
+  auto statistics = sorter.Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kCounting);
+  ASSERT_EQ(statistics.values_number, kNumbers);
+  ASSERT_EQ(statistics.runs_number, 0);
+  ASSERT_EQ(statistics.schedule.size(), 1);
+  ASSERT_EQ(statistics.schedule.front().kind, ts::SortStepKind::kCount);
+  ASSERT_EQ(temp_tapes.GetCreatedTapesNumber(), 0);
+  // the input is read once and its end probed once
+  const auto& input_counts = GetInputTape().GetOperationCounts();
+  ASSERT_EQ(input_counts.reads, kNumbers + 1);
+  ASSERT_EQ(input_counts.rewinds, 0);
+}
+
+TEST_F(SortData, CountingWithoutKeyRange) {
+  constexpr const size_t kNumbers = 20000;
+  constexpr const size_t kBufferSize = 1000;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  options.verify = true;
+
+  // neither the options nor the input tell the range, the merge sorts it
+  auto statistics =
+      ts::TapeSorter(kBufferSize, std::make_unique<ts::TempFileTapeCreator>(),
+                     options)
+          .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kMerge);
+  ASSERT_EQ(statistics.runs_number, kNumbers / kBufferSize);
+  ASSERT_EQ(GetInputTape().GetOperationCounts().rewinds, 0);
+}
+
+TEST_F(SortData, CountingFromStream) {
+  constexpr const size_t kNumbers = 20000;
+  // the block counts 500 keys a pass
+  constexpr const size_t kBufferSize = 1000;
+  auto expected_numbers = GenerateRandomVector(kNumbers, 0, 1999);
+  WriteNumbersToInputTape(expected_numbers);
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  options.key_range = ts::KeyRange{0, 1999};
+
+  // a stream is read once, the range taking four passes is merged
+  auto statistics = [&] {
+    ts::InputStreamTape input_tape(GetInputTempTapePath());
+    return ts::TapeSorter(kBufferSize,
+                          std::make_unique<ts::TempFileTapeCreator>(), options)
+        .Sort(input_tape, GetOutputTape());
+  }();
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kMerge);
+}
+
+TEST_F(SortData, CountingWideRange) {
+  constexpr const size_t kNumbers = 1000;
+  auto expected_numbers = GenerateRandomVector(kNumbers);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  options.key_range = ts::KeyRange{std::numeric_limits<int>::min(),
+                                   std::numeric_limits<int>::max()};
+
+  auto statistics =
+      ts::TapeSorter(100, std::make_unique<ts::TempFileTapeCreator>(), options)
+          .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kMerge);
+  ASSERT_TRUE(std::none_of(statistics.schedule.begin(),
+                           statistics.schedule.end(), [](const auto& step) {
+                             return step.kind == ts::SortStepKind::kCount;
+                           }));
+}
+
+TEST_F(SortData, CountingDescending) {
+  constexpr const size_t kNumbers = 1000;
+  // the block counts the 200 keys in one pass
+  constexpr const size_t kBufferSize = 400;
+  auto expected_numbers = GenerateRandomVector(kNumbers, -100, 99);
+  WriteNumbersToInputTape(expected_numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  options.key_range = ts::KeyRange{-100, 99};
+  options.verify = true;
+
+  auto statistics =
+      ts::TapeSorter(kBufferSize, std::make_unique<ts::TempFileTapeCreator>(),
+                     options, std::greater<int>{})
+          .Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end(),
+            std::greater<int>{});
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.engine, ts::SortEngine::kCounting);
+}
+
+TEST_F(SortData, CountingOutOfKeyRange) {
+  std::vector<int> numbers(100);
+  std::iota(numbers.begin(), numbers.end(), 0);
+  WriteNumbersToInputTape(numbers);
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  options.key_range = ts::KeyRange{0, 50};
+
+  ASSERT_THROW(
+      ts::TapeSorter(200, std::make_unique<ts::TempFileTapeCreator>(), options)
+          .Sort(GetInputTape(), GetOutputTape()),
+      std::out_of_range);
+}
+
+TEST(TapeSorter, CountingNeedsKnownOrderAndKeys) {
+  ts::SortOptions options;
+  options.engine = ts::SortEngine::kCounting;
+  ASSERT_THROW(ts::TapeSorter<ThousandsComparator>(
+                   10, std::make_unique<ts::TempFileTapeCreator>(), options),
+               std::invalid_argument);
+  options.key_range = ts::KeyRange{1, 0};
+  ASSERT_THROW(ts::TapeSorter(10, std::make_unique<ts::TempFileTapeCreator>(),
+                              options),
+               std::invalid_argument);
+}
+
+TEST_F(SortData, TooSmallMemoryBudget) {
+  ASSERT_THROW(ts::TapeSorter(ts::MemoryBudget{1 << 10},
+                              std::make_unique<TrackingTapeCreator>(1 << 10)),
+               std::invalid_argument);
+}
+
 class SortDataLengthParametrized : public SortData,
                                    public testing::WithParamInterface<int> {};
 
@@ -120,6 +1068,46 @@ TEST_P(SortDataLengthParametrized, RandomValues) {
 INSTANTIATE_TEST_SUITE_P(Sort, SortDataLengthParametrized,
                          testing::Values(1, 10, 1000, 1000000));
 
+struct TailRunCase {
+  size_t numbers;
+  size_t runs_number;
+  size_t created_tapes_number;
+  size_t writes;
+};
+
+class SortDataTailRunParametrized
+    : public SortData,
+      public testing::WithParamInterface<TailRunCase> {};
+
+TEST_P(SortDataTailRunParametrized, KeptInMemory) {
+  constexpr const size_t kBufferSize = 64;
+  const auto& tail_run_case = GetParam();
+  auto expected_numbers = GenerateRandomVector(tail_run_case.numbers);
+  WriteNumbersToInputTape(expected_numbers);
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ts::SortOptions options;
+  options.keep_tail_run_in_memory = true;
+  auto temp_tape_creator = std::make_unique<ts::TempFileTapeCreator>();
+  const auto& temp_tapes = *temp_tape_creator;
+  ts::TapeSorter sorter(kBufferSize, std::move(temp_tape_creator), options);
+
+  auto statistics = sorter.Sort(GetInputTape(), GetOutputTape());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+  ASSERT_EQ(statistics.runs_number, tail_run_case.runs_number);
+  // the last block never reaches a temporary tape
+  ASSERT_EQ(temp_tapes.GetCreatedTapesNumber(),
+            tail_run_case.created_tapes_number);
+  ASSERT_EQ(temp_tapes.GetOperationCounts().writes, tail_run_case.writes);
+}
+
+// a short tail, a single short block, an exact multiple of the block and a
+// single full block
+INSTANTIATE_TEST_SUITE_P(Sort, SortDataTailRunParametrized,
+                         testing::Values(TailRunCase{1000, 16, 15, 960},
+                                         TailRunCase{50, 1, 0, 0},
+                                         TailRunCase{1024, 16, 15, 960},
+                                         TailRunCase{64, 1, 0, 0}));
+
 class SortDataBufferParametrized : public SortData,
                                    public testing::WithParamInterface<int> {};
 
@@ -140,3 +1128,69 @@ TEST_P(SortDataBufferParametrized, RandomValues) {
 
 INSTANTIATE_TEST_SUITE_P(Sort, SortDataBufferParametrized,
                          testing::Values(1, 10, 1000, 1000000));
+
+class SortDataLayoutParametrized
+    : public SortData,
+      public testing::WithParamInterface<
+          std::tuple<ts::RunLayout, ts::FileTapeBackend>> {};
+
+TEST_P(SortDataLayoutParametrized, RandomValues) {
+  // runs span several blocks of the direct backend
+  constexpr const auto kNumbersSize = 100000;
+  constexpr const auto kBufferSize = 30000;
+  auto [run_layout, backend] = GetParam();
+  std::vector<int> expected_numbers = GenerateRandomVector(kNumbersSize);
+  WriteNumbersToInputTape(expected_numbers);
+  auto& input_tape = GetInputTape();
+  auto& output_tape = GetOutputTape();
+  ts::SortOptions options;
+  options.run_layout = run_layout;
+
+  ts::TapeSorter(kBufferSize,
+                 std::make_unique<ts::TempFileTapeCreator>(
+                     ts::TapeDelayConfig{}, backend),
+                 options)
+      .Sort(input_tape, output_tape);
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Sort, SortDataLayoutParametrized,
+    testing::Combine(testing::Values(ts::RunLayout::kBackward,
+                                     ts::RunLayout::kForward),
+                     testing::Values(ts::FileTapeBackend::kStream,
+                                     ts::FileTapeBackend::kDirect)));
+
+class SortDataMemoryBudgetParametrized
+    : public SortData,
+      public testing::WithParamInterface<ts::RunLayout> {};
+
+TEST_P(SortDataMemoryBudgetParametrized, RandomValues) {
+  constexpr const size_t kNumbersSize = 300000;
+  constexpr const size_t kMemoryBudget = 256 << 10;
+  constexpr const size_t kTapeMemoryUsage = 24 << 10;
+  std::vector<int> expected_numbers = GenerateRandomVector(kNumbersSize);
+  WriteNumbersToInputTape(expected_numbers);
+  auto temp_tape_creator =
+      std::make_unique<TrackingTapeCreator>(kTapeMemoryUsage);
+  const auto& temp_tapes = *temp_tape_creator;
+  ts::SortOptions options;
+  options.run_layout = GetParam();
+  auto sorter = ts::TapeSorter(ts::MemoryBudget{kMemoryBudget},
+                               std::move(temp_tape_creator), options);
+
+  sorter.Sort(GetInputTape(), GetOutputTape());
+  std::sort(expected_numbers.begin(), expected_numbers.end());
+  ASSERT_EQ(ReadNumbersFromOutputTape(), expected_numbers);
+
+  // blocks take at least half of the budget, the runs are merged early to
+  // stay within the other half
+  ASSERT_GT(temp_tapes.GetCreatedTapesNumber(), temp_tapes.GetMaxLiveTapes());
+  ASSERT_LE(temp_tapes.GetMaxLiveTapes() * kTapeMemoryUsage,
+            kMemoryBudget / 2);
+}
+
+INSTANTIATE_TEST_SUITE_P(Sort, SortDataMemoryBudgetParametrized,
+                         testing::Values(ts::RunLayout::kBackward,
+                                         ts::RunLayout::kForward));
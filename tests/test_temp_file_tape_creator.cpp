@@ -0,0 +1,102 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <filesystem>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/sort/temp_file_tape_creator.h>
+
+namespace ts = tape_sorter;
+namespace fs = std::filesystem;
+
+class TempDirectories : public ::testing::Test {
+  static constexpr const auto kTempDirectory = "temp_directories_data";
+
+ protected:
+  void SetUp() override {
+    fs::create_directories(GetDirectory("first"));
+    fs::create_directories(GetDirectory("second"));
+  }
+
+  void TearDown() override {
+    fs::remove_all(fs::current_path() / kTempDirectory);
+  }
+
+  static fs::path GetDirectory(const std::string& name) {
+    return fs::current_path() / kTempDirectory / name;
+  }
+
+  static size_t CountFiles(const std::string& name) {
+    auto iterator = fs::directory_iterator(GetDirectory(name));
+    return std::distance(fs::begin(iterator), fs::end(iterator));
+  }
+};
+
+TEST_F(TempDirectories, InvalidWeight) {
+  ASSERT_THROW(ts::TempFileTapeCreator({}, ts::FileTapeBackend::kStream,
+                                       {{GetDirectory("first"), 0}}),
+               std::invalid_argument);
+}
+
+TEST_F(TempDirectories, WeightedRoundRobin) {
+  ts::TempFileTapeCreator creator({}, ts::FileTapeBackend::kStream,
+                                  {{GetDirectory("first"), 2},
+                                   {GetDirectory("second"), 1}});
+  std::vector<std::unique_ptr<ts::ITape>> tapes;
+  for (size_t i = 0; i != 3; ++i) {
+    tapes.push_back(creator.Create());
+  }
+  // the turns are interleaved
+  ASSERT_EQ(CountFiles("first"), 2);
+  ASSERT_EQ(CountFiles("second"), 1);
+  for (size_t i = 0; i != 6; ++i) {
+    tapes.push_back(creator.Create());
+  }
+  ASSERT_EQ(CountFiles("first"), 6);
+  ASSERT_EQ(CountFiles("second"), 3);
+
+  tapes.clear();
+  ASSERT_EQ(CountFiles("first"), 0);
+  ASSERT_EQ(CountFiles("second"), 0);
+}
+
+TEST_F(TempDirectories, FreeSpace) {
+  // both directories are on the same file system, so the weights decide
+  ts::TempFileTapeCreator creator(
+      {}, ts::FileTapeBackend::kStream,
+      {{GetDirectory("first"), 1}, {GetDirectory("second"), 3}},
+      ts::TempPlacement::kFreeSpace);
+  std::vector<std::unique_ptr<ts::ITape>> tapes;
+  for (size_t i = 0; i != 8; ++i) {
+    tapes.push_back(creator.Create());
+  }
+  ASSERT_EQ(CountFiles("first"), 2);
+  ASSERT_EQ(CountFiles("second"), 6);
+}
+
+TEST_F(TempDirectories, MergeOutputApartFromSources) {
+  ts::TempFileTapeCreator creator({}, ts::FileTapeBackend::kStream,
+                                  {{GetDirectory("first"), 100},
+                                   {GetDirectory("second"), 1}});
+  auto source = creator.Create();
+  ASSERT_EQ(CountFiles("first"), 1);
+  // the weights would choose the first directory again
+  auto merged = creator.CreateForMerge({source.get()});
+  ASSERT_EQ(CountFiles("second"), 1);
+
+  // every directory is read, any one is fine
+  auto merged_again = creator.CreateForMerge({source.get(), merged.get()});
+  ASSERT_EQ(CountFiles("first") + CountFiles("second"), 3);
+}
@@ -0,0 +1,101 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/thread_pool.h>
+
+namespace ts = tape_sorter;
+
+TEST(ThreadPool, NoThreads) {
+  ASSERT_THROW(ts::ThreadPool(0), std::invalid_argument);
+}
+
+TEST(ThreadPool, RunsSubmittedTasks) {
+  constexpr const size_t kTasksNumber = 1000;
+  std::atomic<size_t> sum{0};
+  {
+    ts::ThreadPool pool(4);
+    for (size_t i = 0; i != kTasksNumber; ++i) {
+      pool.Submit([&sum, i] { sum += i; });
+    }
+  }
+  ASSERT_EQ(sum, kTasksNumber * (kTasksNumber - 1) / 2);
+}
+
+TEST(ThreadPool, SubmittedFromManyThreads) {
+  // tasks go to every queue, and tasks submitted by tasks to their own one
+  constexpr const size_t kSubmittersNumber = 4;
+  constexpr const size_t kTasksNumber = 2000;
+  std::atomic<size_t> calls{0};
+  {
+    ts::ThreadPool pool(3);
+    std::vector<std::thread> submitters;
+    for (size_t i = 0; i != kSubmittersNumber; ++i) {
+      submitters.emplace_back([&pool, &calls] {
+        for (size_t j = 0; j != kTasksNumber; ++j) {
+          pool.Submit([&pool, &calls] {
+            ++calls;
+            pool.Submit([&calls] { ++calls; });
+          });
+        }
+      });
+    }
+    for (auto& submitter : submitters) {
+      submitter.join();
+    }
+  }
+  ASSERT_EQ(calls, 2 * kSubmittersNumber * kTasksNumber);
+}
+
+TEST(ThreadPool, ParallelFor) {
+  constexpr const size_t kTasksNumber = 100;
+  ts::ThreadPool pool(3);
+  std::vector<int> calls(kTasksNumber);
+  pool.ParallelFor(kTasksNumber, [&calls](size_t i) { ++calls[i]; });
+  ASSERT_EQ(std::accumulate(calls.begin(), calls.end(), 0), kTasksNumber);
+  ASSERT_EQ(*std::min_element(calls.begin(), calls.end()), 1);
+}
+
+TEST(ThreadPool, NestedParallelFor) {
+  // Every thread waits inside a task, the waiting threads do the work
+  constexpr const size_t kOuterTasksNumber = 8;
+  constexpr const size_t kInnerTasksNumber = 16;
+  ts::ThreadPool pool(2);
+  std::atomic<size_t> calls{0};
+  pool.ParallelFor(kOuterTasksNumber, [&pool, &calls](size_t) {
+    pool.ParallelFor(kInnerTasksNumber, [&calls](size_t) { ++calls; });
+  });
+  ASSERT_EQ(calls, kOuterTasksNumber * kInnerTasksNumber);
+}
+
+TEST(ThreadPool, ParallelForRethrows) {
+  ts::ThreadPool pool(2);
+  std::atomic<size_t> calls{0};
+  ASSERT_THROW(pool.ParallelFor(10,
+                                [&calls](size_t i) {
+                                  ++calls;
+                                  if (i == 5) {
+                                    throw std::runtime_error("task failed");
+                                  }
+                                }),
+               std::runtime_error);
+  // the other calls are still made
+  ASSERT_EQ(calls, 10);
+}
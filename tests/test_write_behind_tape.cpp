@@ -0,0 +1,169 @@
+//   Copyright (c) 2023, Kirill Ivanov
+//
+//   Licensed under the Apache License, Version 2.0 (the "License");
+//   you may not use this file except in compliance with the License.
+//   You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//   Unless required by applicable law or agreed to in writing, software
+//   distributed under the License is distributed on an "AS IS" BASIS,
+//   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//   See the License for the specific language governing permissions and
+//   limitations under the License.
+
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <tape_sorter/spsc_ring_buffer.h>
+#include <tape_sorter/write_behind_tape.h>
+
+namespace ts = tape_sorter;
+
+// Keeps the values written forward, fails the write at the given position
+class MemoryTape : public ts::ITape {
+ public:
+  explicit MemoryTape(size_t failing_position = SIZE_MAX)
+      : failing_position_(failing_position) {}
+
+  std::optional<int> Read() override {
+    if (position_ == values_.size()) {
+      return std::nullopt;
+    }
+    return values_[position_];
+  }
+
+  void Write(int value) override {
+    if (position_ == values_.size()) {
+      values_.push_back(value);
+    } else {
+      values_[position_] = value;
+    }
+  }
+
+  bool MoveForward() override {
+    if (position_ == values_.size()) {
+      return false;
+    }
+    ++position_;
+    return true;
+  }
+
+  bool MoveBackward() override {
+    if (position_ == 0) {
+      return false;
+    }
+    --position_;
+    return true;
+  }
+
+  void Rewind() override { position_ = 0; }
+
+  void WriteForward(int value) override {
+    if (values_.size() == failing_position_) {
+      throw std::runtime_error("Write failed");
+    }
+    Write(value);
+    MoveForward();
+  }
+
+  const std::vector<int>& GetValues() const { return values_; }
+
+ private:
+  std::vector<int> values_;
+  size_t position_{0};
+  size_t failing_position_;
+};
+
+TEST(SpscRingBuffer, RoundsCapacity) {
+  ASSERT_EQ(ts::SpscRingBuffer<int>(1).GetCapacity(), 1);
+  ASSERT_EQ(ts::SpscRingBuffer<int>(5).GetCapacity(), 8);
+  ASSERT_EQ(ts::SpscRingBuffer<int>(64).GetCapacity(), 64);
+}
+
+TEST(SpscRingBuffer, FullAndWrapAround) {
+  ts::SpscRingBuffer<int> buffer(4);
+  int values[4];
+  for (int round = 0; round != 3; ++round) {
+    for (int i = 0; i != 4; ++i) {
+      ASSERT_TRUE(buffer.TryPush(round * 4 + i));
+    }
+    ASSERT_FALSE(buffer.TryPush(-1));
+    ASSERT_EQ(buffer.TryPop(values, 3), 3);
+    ASSERT_EQ(values[0], round * 4);
+    ASSERT_EQ(values[2], round * 4 + 2);
+    ASSERT_EQ(buffer.TryPop(values, 4), 1);
+    ASSERT_EQ(values[0], round * 4 + 3);
+    ASSERT_TRUE(buffer.Empty());
+    ASSERT_EQ(buffer.TryPop(values, 4), 0);
+  }
+}
+
+TEST(SpscRingBuffer, TwoThreads) {
+  constexpr const int kValuesNumber = 1000000;
+  ts::SpscRingBuffer<int> buffer(256);
+  std::thread producer([&buffer] {
+    for (int i = 0; i != kValuesNumber; ++i) {
+      while (!buffer.TryPush(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  int values[64];
+  int expected_value = 0;
+  while (expected_value != kValuesNumber) {
+    auto values_number = buffer.TryPop(values, 64);
+    if (values_number == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i != values_number; ++i) {
+      ASSERT_EQ(values[i], expected_value++);
+    }
+  }
+  producer.join();
+}
+
+TEST(WriteBehindTape, KeepsOrder) {
+  constexpr const size_t kValuesNumber = 100000;
+  std::vector<int> expected_values(kValuesNumber);
+  std::iota(expected_values.begin(), expected_values.end(), -50000);
+  MemoryTape tape;
+  {
+    // smaller than a batch of the writer
+    ts::WriteBehindTape write_behind_tape(tape, 100);
+    for (auto value : expected_values) {
+      write_behind_tape.WriteForward(value);
+    }
+  }
+  ASSERT_EQ(tape.GetValues(), expected_values);
+}
+
+TEST(WriteBehindTape, OperationsSeePendingValues) {
+  MemoryTape tape;
+  ts::WriteBehindTape write_behind_tape(tape, 16);
+  for (int i = 0; i != 10; ++i) {
+    write_behind_tape.WriteForward(i);
+  }
+  ASSERT_FALSE(write_behind_tape.Read());
+  write_behind_tape.Rewind();
+  for (int i = 0; i != 10; ++i) {
+    ASSERT_EQ(write_behind_tape.ReadForward(), i);
+  }
+  ASSERT_FALSE(write_behind_tape.ReadForward());
+}
+
+TEST(WriteBehindTape, RethrowsWriterError) {
+  MemoryTape tape(500);
+  ts::WriteBehindTape write_behind_tape(tape, 64);
+  ASSERT_THROW(
+      {
+        for (int i = 0; i != 1000; ++i) {
+          write_behind_tape.WriteForward(i);
+        }
+        write_behind_tape.Flush();
+      },
+      std::runtime_error);
+  ASSERT_EQ(tape.GetValues().size(), 500);
+}